@@ -0,0 +1,436 @@
+#include "BoardBench.h"
+
+#include "BoardGrid.h"
+#include "BoardProtocol.h"
+#include "BoardScores.h"
+#include "BoardServer.h"
+#include "BoardSession.h"
+#include "StringFormat.h"
+#include "TouchServer.h"
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Math/Ray.h>
+#include <Urho3D/Scene/Scene.h>
+
+/// Number of the operations run between the checks of the clock.
+static const unsigned BENCH_BATCH = 256;
+/// Tick rate of the simulated clients, one touch per client per tick.
+static const unsigned BENCH_TICK_RATE = 30;
+/// Side of the square territories of the recount board.
+static const int BENCH_BLOCK_SIZE = 8;
+/// Largest step of the simulated touches from the previous touch of the client.
+static const int BENCH_TOUCH_STEP = 3;
+
+URHO3D_DEFINE_APPLICATION_MAIN(BoardBench)
+
+namespace
+{
+    template <class T> void ParseList(const String & value, PODVector<T> & values, T (*parse)(const String &))
+    {
+        values.Clear();
+        for(auto & item : value.Split(','))
+            values.Push(parse(item));
+    }
+
+    int ParseSize(const String & value)
+    {
+        return Max(ToInt(value), 1);
+    }
+
+    unsigned ParseClients(const String & value)
+    {
+        return Clamp(ToUInt(value), 1u, MAX_PLAYERS);
+    }
+}
+
+BoardBench::BoardBench(Context * context)
+    : Application(context)
+    , duration_(1.0f)
+    , seed_(1)
+    , random_(1)
+{
+    TouchServer::RegisterObject(context);
+    BoardGrid::RegisterObject(context);
+    BoardServer::RegisterObject(context);
+
+    sizes_.Push(64);
+    sizes_.Push(256);
+    sizes_.Push(1024);
+    clients_.Push(10);
+    clients_.Push(100);
+    clients_.Push(MAX_PLAYERS);
+}
+
+void BoardBench::Setup()
+{
+    ParseArguments(GetArguments());
+
+    engineParameters_[EP_HEADLESS] = true;
+    engineParameters_[EP_SOUND] = false;
+    engineParameters_[EP_LOG_NAME] = "BoardBench.log";
+}
+
+void BoardBench::Start()
+{
+    scene_ = MakeShared<Scene>(context_);
+    if(!outputFile_.Empty())
+    {
+        output_ = MakeShared<File>(context_, outputFile_, FILE_WRITE);
+        if(!output_->IsOpen())
+        {
+            URHO3D_LOGERRORF("Can not write results to %s", outputFile_.CString());
+            output_.Reset();
+        }
+    }
+
+    for(auto size : sizes_)
+    {
+        BenchRaycast(size);
+        for(auto numClients : clients_)
+        {
+            BenchClaims(size, numClients);
+            BenchReplication(size, numClients);
+            BenchRecount(size, numClients);
+            BenchWire(size, numClients);
+        }
+    }
+
+    output_.Reset();
+    engine_->Exit();
+}
+
+void BoardBench::ParseArguments(const Vector<String> & arguments)
+{
+    for(unsigned i = 0; i + 1 < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        const String & value = arguments[i + 1];
+
+        if(argument == "--sizes")
+            ParseList(value, sizes_, &ParseSize);
+        else if(argument == "--clients")
+            ParseList(value, clients_, &ParseClients);
+        else if(argument == "--duration")
+            duration_ = Max(ToFloat(value), 0.01f);
+        else if(argument == "--seed")
+            seed_ = ToUInt(value);
+        else if(argument == "--output")
+            outputFile_ = value;
+        else
+            continue;
+        ++i;
+    }
+}
+
+void BoardBench::BenchRaycast(int size)
+{
+    random_ = seed_ ? seed_ : 1;
+
+    auto grid = scene_->CreateComponent<BoardGrid>(LOCAL);
+    grid->SetSize(size, size);
+
+    // Rays from above the board at random angles, as the camera picks
+    HiresTimer timer;
+    unsigned numPicks = 0;
+    unsigned numHits = 0;
+    while(timer.GetUSec(false) < duration_ * 1000000)
+    {
+        for(unsigned i = 0; i < BENCH_BATCH; ++i)
+        {
+            auto target = grid->GetCellPosition(NextRandom() % grid->GetNumCells());
+            auto dx = static_cast<int>(NextRandom() % 2001) - 1000;
+            auto dz = static_cast<int>(NextRandom() % 2001) - 1000;
+            Vector3 origin(target.x_ + dx * 0.01f, 20.0f, target.z_ + dz * 0.01f);
+
+            unsigned cell;
+            float distance;
+            if(grid->Raycast(Ray(origin, target - origin), cell, distance) && cell != M_MAX_UNSIGNED)
+                ++numHits;
+        }
+        numPicks += BENCH_BATCH;
+    }
+    auto seconds = timer.GetUSec(false) / 1000000.0f;
+    grid->Remove();
+
+    WriteResult(FormatString("{\"bench\":\"raycast\",\"size\":%d,\"picks\":%u,\"hits\":%u,\"seconds\":%.3f,\"picks_per_s\":%.0f}",
+        size, numPicks, numHits, seconds, numPicks / seconds));
+}
+
+void BoardBench::BenchClaims(int size, unsigned numClients)
+{
+    random_ = seed_ ? seed_ : 1;
+
+    auto session = MakeShared<BoardSession>(context_);
+    session->SetAutoTick(false);
+    session->Start(scene_, size, MAX_PLAYERS);
+    auto grid = session->GetGrid();
+
+    // Every client touches a random cell every tick, the half full board starts a new round
+    HiresTimer timer;
+    unsigned roundClaims = 0;
+    unsigned numTicks = 0;
+    unsigned numClaims = 0;
+    while(timer.GetUSec(false) < duration_ * 1000000)
+    {
+        for(unsigned client = 1; client <= numClients; ++client)
+            session->QueueClaim(NextRandom() % grid->GetNumCells(), static_cast<unsigned char>(client));
+        session->ResolveClaims();
+        grid->ClearDirty();
+        if((session->GetNumClaims() - roundClaims) * 2 > grid->GetNumCells())
+        {
+            session->NewRound();
+            roundClaims = session->GetNumClaims();
+        }
+
+        numClaims += numClients;
+        ++numTicks;
+    }
+    auto seconds = timer.GetUSec(false) / 1000000.0f;
+
+    WriteResult(FormatString("{\"bench\":\"claims\",\"size\":%d,\"clients\":%u,\"ticks\":%u,\"claims\":%u,\"won\":%u,\"seconds\":%.3f,"
+        "\"claims_per_s\":%.0f,\"us_per_tick\":%.2f}", size, numClients, numTicks, numClaims, session->GetNumClaims(), seconds,
+        numClaims / seconds, seconds * 1000000.0f / Max(numTicks, 1u)));
+
+    session->Stop();
+}
+
+void BoardBench::BenchReplication(int size, unsigned numClients)
+{
+    random_ = seed_ ? seed_ : 1;
+
+    auto session = MakeShared<BoardSession>(context_);
+    session->SetAutoTick(false);
+    session->Start(scene_, size, MAX_PLAYERS);
+    auto grid = session->GetGrid();
+
+    // The tick encodes its changed cells once for every client, as BoardServer does for the clients seeing all the chunks
+    VectorBuffer message;
+    PODVector<unsigned> cells;
+    HiresTimer timer;
+    unsigned roundClaims = 0;
+    long long encodeTime = 0;
+    unsigned long long numBytes = 0;
+    unsigned numTicks = 0;
+    while(timer.GetUSec(false) < duration_ * 1000000)
+    {
+        for(unsigned client = 1; client <= numClients; ++client)
+            session->QueueClaim(NextRandom() % grid->GetNumCells(), static_cast<unsigned char>(client));
+        session->ResolveClaims();
+
+        HiresTimer encodeTimer;
+        cells = grid->GetDirtyCells();
+        Sort(cells.Begin(), cells.End());
+        for(unsigned client = 0; client < numClients; ++client)
+        {
+            message.Clear();
+            WriteBoardDelta(message, *grid, cells, numTicks, numTicks);
+            numBytes += message.GetSize();
+        }
+        encodeTime += encodeTimer.GetUSec(false);
+
+        grid->ClearDirty();
+        if((session->GetNumClaims() - roundClaims) * 2 > grid->GetNumCells())
+        {
+            session->NewRound();
+            roundClaims = session->GetNumClaims();
+        }
+        ++numTicks;
+    }
+    numTicks = Max(numTicks, 1u);
+
+    // The join sends all the chunks of the board
+    PODVector<unsigned> chunks;
+    auto numChunks = grid->GetNumChunks();
+    for(unsigned i = 0; i < static_cast<unsigned>(numChunks.x_ * numChunks.y_); ++i)
+        chunks.Push(i);
+    message.Clear();
+    WriteBoardChunks(message, *grid, chunks);
+
+    WriteResult(FormatString("{\"bench\":\"replication\",\"size\":%d,\"clients\":%u,\"ticks\":%u,\"bytes_per_tick\":%.1f,"
+        "\"bytes_per_client_per_s\":%.1f,\"encode_us_per_tick\":%.2f,\"join_bytes\":%u}", size, numClients, numTicks,
+        static_cast<double>(numBytes) / numTicks, static_cast<double>(numBytes) / numTicks / numClients * BENCH_TICK_RATE,
+        static_cast<double>(encodeTime) / numTicks, message.GetSize()));
+
+    session->Stop();
+}
+
+void BoardBench::BenchRecount(int size, unsigned numClients)
+{
+    random_ = seed_ ? seed_ : 1;
+
+    // The territories are the blocks of the cells of random players
+    BoardScores scores;
+    scores.Reset(size, size);
+    PODVector<unsigned char> blocks;
+    auto blocksPerRow = (size + BENCH_BLOCK_SIZE - 1) / BENCH_BLOCK_SIZE;
+    for(int i = 0; i < blocksPerRow * blocksPerRow; ++i)
+        blocks.Push(static_cast<unsigned char>(NextRandom() % numClients + 1));
+    for(int y = 0; y < size; ++y)
+    {
+        for(int x = 0; x < size; ++x)
+            scores.Claim(y * size + x, blocks[(y / BENCH_BLOCK_SIZE) * blocksPerRow + x / BENCH_BLOCK_SIZE]);
+    }
+
+    HiresTimer timer;
+    unsigned numRecounts = 0;
+    while(timer.GetUSec(false) < duration_ * 1000000)
+    {
+        for(unsigned slot = 1; slot <= numClients; ++slot)
+        {
+            unsigned cells, regions, largest;
+            scores.Recount(static_cast<unsigned char>(slot), cells, regions, largest);
+        }
+        ++numRecounts;
+    }
+    auto seconds = timer.GetUSec(false) / 1000000.0f;
+
+    WriteResult(FormatString("{\"bench\":\"recount\",\"size\":%d,\"clients\":%u,\"recounts\":%u,\"us_per_recount\":%.2f}",
+        size, numClients, numRecounts, seconds * 1000000.0f / Max(numRecounts, 1u)));
+}
+
+void BoardBench::BenchWire(int size, unsigned numClients)
+{
+    random_ = seed_ ? seed_ : 1;
+
+    auto session = MakeShared<BoardSession>(context_);
+    session->SetAutoTick(false);
+    session->Start(scene_, size, MAX_PLAYERS);
+    auto grid = session->GetGrid();
+    auto mirror = scene_->CreateComponent<BoardGrid>(LOCAL);
+    mirror->SetSize(size, size);
+
+    // Every client touches near its previous touch and jumps sometimes, as the players paint the territories
+    PODVector<unsigned> lastCells(numClients);
+    for(auto & cell : lastCells)
+        cell = NextRandom() % grid->GetNumCells();
+
+    VectorBuffer message;
+    PODVector<unsigned> cells;
+    PODVector<TouchData> touches;
+    PODVector<TouchData> received;
+    unsigned roundClaims = 0;
+    unsigned long long deltaBytes = 0;
+    unsigned long long packedBits = 0;
+    unsigned long long touchBytes = 0;
+    unsigned numCells = 0;
+    unsigned numTouches = 0;
+    unsigned numErrors = 0;
+    unsigned numTicks = 0;
+    HiresTimer timer;
+    while(timer.GetUSec(false) < duration_ * 1000000)
+    {
+        for(unsigned client = 0; client < numClients; ++client)
+        {
+            auto cell = lastCells[client];
+            if(NextRandom() % 8)
+            {
+                auto dx = static_cast<int>(NextRandom() % (BENCH_TOUCH_STEP * 2 + 1)) - BENCH_TOUCH_STEP;
+                auto dy = static_cast<int>(NextRandom() % (BENCH_TOUCH_STEP * 2 + 1)) - BENCH_TOUCH_STEP;
+                auto x = Clamp(static_cast<int>(cell) % size + dx, 0, size - 1);
+                auto y = Clamp(static_cast<int>(cell) / size + dy, 0, size - 1);
+                cell = static_cast<unsigned>(y * size + x);
+            }
+            else
+                cell = NextRandom() % grid->GetNumCells();
+            lastCells[client] = cell;
+
+            TouchData touch;
+            touch.cell_ = cell;
+            touch.sequence_ = numTicks;
+            touch.time_ = numTicks * 1000 / BENCH_TICK_RATE;
+            touches.Push(touch);
+            session->QueueClaim(cell, static_cast<unsigned char>(client + 1));
+        }
+        session->ResolveClaims();
+
+        // One batch of the touches of every client per tick, as TouchClient sends them
+        for(unsigned client = 0; client < numClients; ++client)
+        {
+            message.Clear();
+            WriteTouchBatch(message, PODVector<TouchData>(&touches[client], 1));
+            touchBytes += message.GetSize();
+
+            received.Clear();
+            MemoryBuffer source(message.GetData(), message.GetSize());
+            if(!ReadTouchBatch(source, received) || received.Size() != 1 || received[0].cell_ != touches[client].cell_)
+                ++numErrors;
+        }
+        numTouches += touches.Size();
+        touches.Clear();
+
+        // The delta against the fixed width cell and owner of every changed cell, the previous encoding
+        cells = grid->GetDirtyCells();
+        Sort(cells.Begin(), cells.End());
+        unsigned char maxOwner = NO_OWNER;
+        for(auto cell : cells)
+            maxOwner = Max(maxOwner, grid->GetOwner(cell));
+        message.Clear();
+        WriteBoardDelta(message, *grid, cells, numTicks, numTicks);
+        deltaBytes += message.GetSize();
+        packedBits += cells.Size() * (GetBitsFor(grid->GetNumCells() - 1) + GetBitsFor(maxOwner));
+        numCells += cells.Size();
+
+        unsigned sequence, tick;
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        if(!ReadBoardDelta(source, *mirror, sequence, tick))
+            ++numErrors;
+        for(auto cell : cells)
+        {
+            if(mirror->GetOwner(cell) != grid->GetOwner(cell))
+                ++numErrors;
+        }
+
+        grid->ClearDirty();
+        if((session->GetNumClaims() - roundClaims) * 2 > grid->GetNumCells())
+        {
+            session->NewRound();
+            mirror->SetSize(size, size);
+            roundClaims = session->GetNumClaims();
+        }
+        ++numTicks;
+    }
+
+    // The join of the whole board, with the territories of the last round
+    PODVector<unsigned> chunks;
+    auto numChunks = grid->GetNumChunks();
+    for(unsigned i = 0; i < static_cast<unsigned>(numChunks.x_ * numChunks.y_); ++i)
+        chunks.Push(i);
+    message.Clear();
+    WriteBoardChunks(message, *grid, chunks);
+    unsigned char maxOwner = NO_OWNER;
+    for(unsigned cell = 0; cell < grid->GetNumCells(); ++cell)
+        maxOwner = Max(maxOwner, grid->GetOwner(cell));
+
+    WriteResult(FormatString("{\"bench\":\"wire\",\"size\":%d,\"clients\":%u,\"ticks\":%u,\"delta_bytes_per_cell\":%.2f,"
+        "\"packed_bytes_per_cell\":%.2f,\"touch_bytes_per_touch\":%.2f,\"join_bytes\":%u,\"packed_join_bytes\":%u,\"roundtrip_errors\":%u}",
+        size, numClients, numTicks, static_cast<double>(deltaBytes) / Max(numCells, 1u), packedBits / 8.0 / Max(numCells, 1u),
+        static_cast<double>(touchBytes) / Max(numTouches, 1u), message.GetSize(), (grid->GetNumCells() * GetBitsFor(maxOwner) + 7) / 8,
+        numErrors));
+
+    mirror->Remove();
+    session->Stop();
+}
+
+void BoardBench::WriteResult(const String & line)
+{
+    PrintLine(line);
+    if(output_)
+        output_->WriteLine(line);
+}
+
+unsigned BoardBench::NextRandom()
+{
+    // xorshift32, the same sequence for the same seed
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
@@ -0,0 +1,57 @@
+#ifndef _BOARD_BENCH_H_INCLUDED__
+#define _BOARD_BENCH_H_INCLUDED__
+
+#include <Urho3D/Engine/Application.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class File;
+    class Scene;
+}
+
+/// Headless microbenchmarks of the server hot paths in isolation: the cell picking, the claim resolution,
+/// the replication encoding, the score recount and the wire bytes, over the board sizes and the client counts.
+/// Every case prints one JSON line (and appends it to the output file if set), then the application exits.
+class BoardBench : public Application
+{
+    URHO3D_OBJECT(BoardBench, Application);
+
+public:
+
+    explicit BoardBench(Context * context);
+
+    virtual void Setup();
+    virtual void Start();
+
+private:
+
+    void ParseArguments(const Vector<String> & arguments);
+    /// Ray picks of the cells per second.
+    void BenchRaycast(int size);
+    /// Claims queued by the clients and resolved per tick.
+    void BenchClaims(int size, unsigned numClients);
+    /// Delta bytes and encoding time per tick for every client, and the bytes of the whole board join.
+    void BenchReplication(int size, unsigned numClients);
+    /// Full recount of the scores of the players on the filled board.
+    void BenchRecount(int size, unsigned numClients);
+    /// Wire bytes of the changed cells and the touches against the fixed width cell indices, checked by the decoding.
+    void BenchWire(int size, unsigned numClients);
+    void WriteResult(const String & line);
+    unsigned NextRandom();
+
+private:
+
+    SharedPtr<Scene> scene_;
+    SharedPtr<File> output_;
+    PODVector<int> sizes_;
+    PODVector<unsigned> clients_;
+    /// Run time of every case in seconds.
+    float duration_;
+    unsigned seed_;
+    unsigned random_;
+    String outputFile_;
+};
+
+#endif // _BOARD_BENCH_H_INCLUDED__
@@ -21,6 +21,8 @@
 //
 
 #include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Engine/Engine.h>
 #include <Urho3D/Engine/EngineDefs.h>
 #include <Urho3D/Graphics/Camera.h>
@@ -44,6 +46,7 @@
 #include <Urho3D/Physics/PhysicsWorld.h>
 #include <Urho3D/Physics/RigidBody.h>
 #include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Resource/ResourceEvents.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/UI/Button.h>
 #include <Urho3D/UI/Font.h>
@@ -53,33 +56,68 @@
 #include <Urho3D/UI/UIEvents.h>
 
 #include "Board.h"
-#include "BoardState.h"
+#include "BoardClient.h"
+#include "BoardGrid.h"
+#include "BoardProfiler.h"
+#include "BoardRenderer.h"
+#include "BoardRooms.h"
+#include "BoardServer.h"
+#include "BoardSession.h"
+#include "BoardView.h"
 #include "BoardCamera.h"
+#include "StringFormat.h"
 
 #include "TouchDispatcher.h"
 #include "TouchClient.h"
 #include "TouchServer.h"
 #include "TouchEvent.h"
+#include "TouchJournal.h"
 
 
-// UDP port we will use
+// UDP port we will use by default
 static const unsigned short SERVER_PORT = 2345;
+// Number of cells along each side of the board by default
+static const int BOARD_SIZE = 20;
+
+// Resources of the board loaded in the background at the start, used when the first snapshot arrives.
+// The UI style and font are needed by the first frame and stay synchronous
+static const char* PRELOAD_MATERIALS[] = { "Materials/Board.xml" };
 
 URHO3D_DEFINE_APPLICATION_MAIN(Board)
 
 Board::Board(Context* context)
     : Application(context)
+    , serverMode_(false)
+    , serverPort_(SERVER_PORT)
+    , boardSize_(BOARD_SIZE)
+    , maxPlayers_(MAX_PLAYERS)
+    , tickRate_(DEFAULT_TICK_RATE)
+    , roundTime_(0.0f)
+    , maxRooms_(DEFAULT_MAX_ROOMS)
 {
     TouchDispatcher::RegisterObject(context);
     TouchClient::RegisterObject(context);
     TouchServer::RegisterObject(context);
-    BoardState::RegisterObject(context);
+    BoardGrid::RegisterObject(context);
+    BoardView::RegisterObject(context);
+    BoardServer::RegisterObject(context);
+    BoardClient::RegisterObject(context);
+    BoardRenderer::RegisterObject(context);
     BoardCamera::RegisterObject(context);
 }
 
 void Board::Setup()
 {
+    ParseArguments(GetArguments());
+
     engineParameters_[EP_FULL_SCREEN]  = false;
+
+    // Dedicated server does not need a window, a renderer or sound
+    if(serverMode_)
+    {
+        engineParameters_[EP_HEADLESS] = true;
+        engineParameters_[EP_SOUND] = false;
+    }
 }
 
 void Board::Start()
@@ -87,6 +125,28 @@ void Board::Start()
     // Create the scene content
     CreateScene();
 
+    if(!replayFile_.Empty())
+    {
+        Replay();
+        return;
+    }
+
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Board, HandleFirstFrame));
+
+    if(serverMode_)
+    {
+        // The dedicated server sleeps between the ticks and flushes the network once per tick
+        engine_->SetMaxFps(tickRate_);
+        GetSubsystem<Network>()->SetUpdateFps(tickRate_);
+
+        SubscribeToNetworkEvents();
+        CreateProfiler();
+        StartServer();
+        return;
+    }
+
+    PreloadResources();
+
     // Create the UI content
     CreateUI();
 
@@ -130,6 +190,9 @@ void Board::CreateScene()
     // network messages. Furthermore, because the client removes all replicated scene nodes when connecting to a server scene,
     // the screen would become blank if the camera node was replicated (as only the locally created camera is assigned to a
     // viewport in SetupViewports() below)
+    if(serverMode_)
+        return;
+
     cameraNode_ = scene_->CreateChild("Camera", LOCAL);
     Camera* camera = cameraNode_->CreateComponent<Camera>();
     camera->SetFarClip(100.0f);
@@ -191,11 +254,15 @@ void Board::SubscribeToEvents()
     SubscribeToEvent(disconnectButton_, E_RELEASED, URHO3D_HANDLER(Board, HandleDisconnect));
     SubscribeToEvent(startServerButton_, E_RELEASED, URHO3D_HANDLER(Board, HandleStartServer));
 
-    // Subscribe to network events
+    SubscribeToNetworkEvents();
+}
+
+void Board::SubscribeToNetworkEvents()
+{
     SubscribeToEvent(E_SERVERCONNECTED, URHO3D_HANDLER(Board, HandleConnectionStatus));
     SubscribeToEvent(E_SERVERDISCONNECTED, URHO3D_HANDLER(Board, HandleConnectionStatus));
     SubscribeToEvent(E_CONNECTFAILED, URHO3D_HANDLER(Board, HandleConnectionStatus));
-    SubscribeToEvent(E_CLIENTCONNECTED, URHO3D_HANDLER(Board, HandleClientConnected));
+    SubscribeToEvent(E_CLIENTIDENTITY, URHO3D_HANDLER(Board, HandleClientIdentity));
     SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(Board, HandleClientDisconnected));
 }
 
@@ -218,6 +285,10 @@ Button* Board::CreateButton(const String& text, int width)
 
 void Board::UpdateButtons()
 {
+    // No UI in the dedicated server mode
+    if(!buttonContainer_)
+        return;
+
     auto network = GetSubsystem<Network>();
     auto serverConnection = network->GetServerConnection();
     bool serverRunning = network->IsServerRunning();
@@ -229,29 +300,6 @@ void Board::UpdateButtons()
     textEdit_->SetVisible(!serverConnection && !serverRunning);
 }
 
-void Board::CreateBoard()
-{
-    auto cache = GetSubsystem<ResourceCache>();
-
-    const int BOARD_SIZE = 10;
-    for(int y = -BOARD_SIZE; y < BOARD_SIZE; ++y)
-    {
-        for(int x = -BOARD_SIZE; x < BOARD_SIZE; ++x)
-        {
-            auto node = scene_->CreateChild("Cell");
-            node->SetPosition(Vector3(x * 1.6f, 0.0f, y * 1.6f));
-            node->SetScale(Vector3(1.5f, 0.5f, 1.5f));
-
-            auto model = node->CreateComponent<StaticModel>();
-            model->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
-            model->SetMaterial(cache->GetResource<Material>("Materials/Empty.xml"));
-
-            node->CreateComponent<TouchClient>();
-            node->CreateComponent<BoardState>(LOCAL);
-        }
-    }
-}
-
 void Board::HandleKeyUp(StringHash , VariantMap& eventData)
 {
     using namespace KeyUp;
@@ -261,21 +309,6 @@ void Board::HandleKeyUp(StringHash , VariantMap& eventData)
         engine_->Exit();
 }
 
-void Board::HandleTouchReaction(StringHash eventType, VariantMap& eventData)
-{
-    using namespace TouchReaction;
-
-    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
-    auto node = static_cast<Node*>(eventData[P_NODE].GetPtr());
-    auto state = node->GetComponent<BoardState>();
-    if(!state->GetBusy())
-    {
-        state->SetBusy(true);
-        auto model = node->GetComponent<StaticModel>();
-        model->SetMaterial(connectionResources_[connection]->material_);
-    }
-}
-
 void Board::HandleConnect(StringHash eventType, VariantMap& eventData)
 {
     auto network = GetSubsystem<Network>();
@@ -283,8 +316,15 @@ void Board::HandleConnect(StringHash eventType, VariantMap& eventData)
     if(address.Empty())
         address = "localhost";
 
-    network->Connect(address, SERVER_PORT, scene_);
-    scene_->CreateComponent<TouchDispatcher>(LOCAL);
+    // The server routes the connection to the room of the identity
+    VariantMap identity;
+    if(!roomName_.Empty())
+        identity[ROOM_IDENTITY] = roomName_;
+    network->Connect(address, serverPort_, scene_, identity);
+    scene_->GetOrCreateComponent<TouchDispatcher>(LOCAL);
+    scene_->GetOrCreateComponent<TouchClient>(LOCAL);
+    scene_->GetOrCreateComponent<BoardClient>(LOCAL);
+    scene_->GetOrCreateComponent<BoardView>(LOCAL);
 
     UpdateButtons();
 }
@@ -296,10 +336,12 @@ void Board::HandleDisconnect(StringHash eventType, VariantMap& eventData)
     {
         serverConnection->Disconnect();
         scene_->Clear(true, false);
+        scene_->RemoveComponent<BoardGrid>();
     }
     else if(network->IsServerRunning())
     {
         network->StopServer();
+        rooms_.Reset();
         scene_->Clear(true, false);
     }
 
@@ -308,59 +350,261 @@ void Board::HandleDisconnect(StringHash eventType, VariantMap& eventData)
 
 void Board::HandleStartServer(StringHash eventType, VariantMap& eventData)
 {
-    GetSubsystem<Network>()->StartServer(SERVER_PORT);
+    StartServer();
+}
 
-    CreateBoard();
+void Board::CreateProfiler()
+{
+    if(metricsOutput_.Empty() && traceOutput_.Empty())
+        return;
 
-    scene_->CreateComponent<TouchServer>(LOCAL);
-    SubscribeToEvent(E_TOUCHREACTION, URHO3D_HANDLER(Board, HandleTouchReaction));
+    auto profiler = new BoardProfiler(context_);
+    context_->RegisterSubsystem(profiler);
+    profiler->SetMetricsOutput(metricsOutput_);
+    profiler->SetTraceOutput(traceOutput_);
+}
 
-    static String resources[] =
+void Board::Replay()
+{
+    TouchJournalReader reader;
+    if(!reader.Open(context_, replayFile_))
     {
-        "Materials/Red.xml",
-        "Materials/Blue.xml",
-        "Materials/Green.xml",
-        "Materials/Yellow.xml"
-    };
+        engine_->Exit();
+        return;
+    }
 
-    auto cache = GetSubsystem<ResourceCache>();
+    // The session boards are square, the cells of another board would map to the wrong coordinates
+    if(reader.GetWidth() != reader.GetHeight())
+    {
+        URHO3D_LOGERRORF("Can not replay %s, the board %dx%d is not square", replayFile_.CString(), reader.GetWidth(), reader.GetHeight());
+        engine_->Exit();
+        return;
+    }
 
-    freeResources_.Clear();
-    for(auto & resource : resources)
+    session_ = MakeShared<BoardSession>(context_);
+    session_->Start(scene_, reader.GetWidth(), MAX_PLAYERS);
+    auto grid = session_->GetGrid();
+
+    // The claims of a tick are resolved together, as on the server
+    unsigned numTouches = 0;
+    unsigned numTicks = 0;
+    HiresTimer timer;
+    JournalRecord record;
+    auto hasRecord = reader.Read(record);
+    while(hasRecord)
     {
-        auto material = cache->GetResource<Material>(resource);
-        freeResources_.Push(MakeShared<ClientResources>(material));
+        auto tick = record.tick_;
+        do
+        {
+            // The round marker goes first in its tick, before the touches of the new round
+            if(record.slot_ == NO_OWNER)
+                session_->NewRound();
+            else
+            {
+                session_->QueueClaim(record.cell_, record.slot_);
+                ++numTouches;
+            }
+            hasRecord = reader.Read(record);
+        }
+        while(hasRecord && record.tick_ == tick);
+
+        session_->ResolveClaims();
+        grid->ClearDirty();
+        ++numTicks;
     }
+    auto seconds = Max(timer.GetUSec(false) / 1000000.0f, M_EPSILON);
 
-    UpdateButtons();
+    // Same journal gives the same board, compare the hashes of the runs
+    unsigned hash = 2166136261u;
+    for(auto owner : grid->GetCellsAttr())
+        hash = (hash ^ owner) * 16777619u;
+
+    // The end of round evaluation recounts the bitboards, it must agree with the incremental counts
+    auto & scores = session_->GetScores();
+    timer.Reset();
+    for(unsigned slot = 1; slot <= MAX_PLAYERS; ++slot)
+    {
+        unsigned cells, regions, largest;
+        scores.Recount(static_cast<unsigned char>(slot), cells, regions, largest);
+        if(cells != scores.GetCells(slot) || regions != scores.GetRegions(slot) || largest != scores.GetLargestRegion(slot))
+        {
+            URHO3D_LOGERRORF("Slot %u recount %u cells %u regions %u largest, incremental %u cells %u regions %u largest", slot,
+                cells, regions, largest, scores.GetCells(slot), scores.GetRegions(slot), scores.GetLargestRegion(slot));
+        }
+    }
+    auto recountUs = timer.GetUSec(false);
+    auto leader = scores.GetLeader();
+
+    PrintLine(FormatString("{\"touches\":%u,\"ticks\":%u,\"claims\":%u,\"rejected\":%u,\"seconds\":%.3f,"
+        "\"touches_per_s\":%.0f,\"board_hash\":\"%08x\",\"leader\":%u,\"leader_cells\":%u,\"leader_regions\":%u,"
+        "\"recount_us\":%lld}", numTouches, numTicks, session_->GetNumClaims(), session_->GetNumRejected(), seconds,
+        numTouches / seconds, hash, leader, scores.GetCells(leader), scores.GetRegions(leader), recountUs));
+
+    session_.Reset();
+    engine_->Exit();
 }
 
-void Board::HandleConnectionStatus(StringHash eventType, VariantMap& eventData)
+void Board::StartServer()
 {
+    if(!GetSubsystem<Network>()->StartServer(serverPort_))
+    {
+        URHO3D_LOGERRORF("Failed to start server on port %d", serverPort_);
+        if(serverMode_)
+            engine_->Exit();
+        return;
+    }
+
+    HiresTimer timer;
+    rooms_ = MakeShared<BoardRooms>(context_);
+    rooms_->SetTickRate(tickRate_);
+    rooms_->SetRoundTime(roundTime_);
+    rooms_->SetMaxRooms(maxRooms_);
+    rooms_->Start(scene_, boardSize_, maxPlayers_, snapshotFile_);
+    if(!journalFile_.Empty())
+        rooms_->StartJournal(journalFile_);
+
+    // The dedicated server is ready from the start of the process, the one started by the button from the click
+    ReportStartup("server_ready", serverMode_ ? startupTimer_.GetUSec(false) : timer.GetUSec(false));
+
     UpdateButtons();
 }
 
-void Board::HandleClientConnected(StringHash eventType, VariantMap& eventData)
+void Board::PreloadResources()
 {
-    using namespace ClientConnected;
+    auto cache = GetSubsystem<ResourceCache>();
+    SubscribeToEvent(E_RESOURCEBACKGROUNDLOADED, URHO3D_HANDLER(Board, HandleResourceLoaded));
 
-    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
-    if(freeResources_.Empty())
+    // The dependencies of the resources (techniques, textures) are queued by the resources themselves
+    for(auto name : PRELOAD_MATERIALS)
+    {
+        if(cache->BackgroundLoadResource<Material>(name))
+            preloading_.Insert(StringHash(name));
+    }
+}
+
+void Board::ReportStartup(const char* stage, long long usec)
+{
+    URHO3D_LOGINFO(FormatString("Startup %s in %.1f ms", stage, usec / 1000.0f));
+    if(auto profiler = GetSubsystem<BoardProfiler>())
+        profiler->WriteMetricsLine(FormatString("{\"startup\":\"%s\",\"ms\":%.1f}", stage, usec / 1000.0f));
+}
+
+void Board::ParseArguments(const Vector<String>& arguments)
+{
+    for(unsigned i = 0; i < arguments.Size(); ++i)
     {
-        connection->Disconnect();
+        String argument = arguments[i].ToLower();
+        String value = i + 1 < arguments.Size() ? arguments[i + 1] : String::EMPTY;
+
+        if(argument == "--server")
+            serverMode_ = true;
+        else if(argument == "--port" && !value.Empty())
+        {
+            serverPort_ = static_cast<unsigned short>(ToUInt(value));
+            ++i;
+        }
+        else if(argument == "--size" && !value.Empty())
+        {
+            boardSize_ = Max(ToInt(value), 1);
+            ++i;
+        }
+        else if(argument == "--players" && !value.Empty())
+        {
+            maxPlayers_ = Clamp(ToUInt(value), 1u, MAX_PLAYERS);
+            ++i;
+        }
+        else if(argument == "--tick" && !value.Empty())
+        {
+            tickRate_ = Clamp(ToUInt(value), 1u, 1000u);
+            ++i;
+        }
+        else if(argument == "--rooms" && !value.Empty())
+        {
+            maxRooms_ = Max(ToUInt(value), 1u);
+            ++i;
+        }
+        else if(argument == "--room" && !value.Empty())
+        {
+            roomName_ = value;
+            ++i;
+        }
+        else if(argument == "--round" && !value.Empty())
+        {
+            roundTime_ = Max(ToFloat(value), 0.0f);
+            ++i;
+        }
+        else if(argument == "--metrics" && !value.Empty())
+        {
+            metricsOutput_ = value;
+            ++i;
+        }
+        else if(argument == "--trace" && !value.Empty())
+        {
+            traceOutput_ = value;
+            ++i;
+        }
+        else if(argument == "--snapshot" && !value.Empty())
+        {
+            snapshotFile_ = value;
+            ++i;
+        }
+        else if(argument == "--journal" && !value.Empty())
+        {
+            journalFile_ = value;
+            ++i;
+        }
+        else if(argument == "--replay" && !value.Empty())
+        {
+            // Replay runs headless like the server, without the network
+            replayFile_ = value;
+            serverMode_ = true;
+            ++i;
+        }
+    }
+}
+
+void Board::HandleFirstFrame(StringHash eventType, VariantMap& eventData)
+{
+    ReportStartup("first_frame", startupTimer_.GetUSec(false));
+    UnsubscribeFromEvent(E_ENDFRAME);
+}
+
+void Board::HandleResourceLoaded(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ResourceBackgroundLoaded;
+
+    if(!preloading_.Erase(StringHash(eventData[P_RESOURCENAME].GetString())))
         return;
+
+    if(!eventData[P_SUCCESS].GetBool())
+        URHO3D_LOGWARNINGF("Failed to preload %s", eventData[P_RESOURCENAME].GetString().CString());
+    if(preloading_.Empty())
+    {
+        ReportStartup("resources_preloaded", startupTimer_.GetUSec(false));
+        UnsubscribeFromEvent(E_RESOURCEBACKGROUNDLOADED);
     }
+}
 
-    connection->SetScene(scene_);
-    connectionResources_[connection] = freeResources_.Front();
-    freeResources_.PopFront();
+void Board::HandleConnectionStatus(StringHash eventType, VariantMap& eventData)
+{
+    UpdateButtons();
+}
+
+void Board::HandleClientIdentity(StringHash eventType, VariantMap& eventData)
+{
+    using namespace ClientIdentity;
+
+    // The identity carries the room name, so the connection joins a room only now
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    if(!rooms_ || !rooms_->AddConnection(connection))
+        eventData[P_ALLOW] = false;
 }
 
 void Board::HandleClientDisconnected(StringHash eventType, VariantMap& eventData)
 {
-    using namespace ClientConnected;
+    using namespace ClientDisconnected;
 
     auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
-    if(auto resource = connectionResources_[connection])
-        freeResources_.Push(resource);
+    if(rooms_)
+        rooms_->RemoveConnection(connection);
 }
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <Urho3D/Container/HashSet.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Engine/Application.h>
 
 namespace Urho3D
@@ -33,9 +35,11 @@ namespace Urho3D
     class Text;
     class UIElement;
     class Drawable;
-    class Material;
 }
 
+class BoardRooms;
+class BoardSession;
+
 // All Urho3D classes reside in namespace Urho3D
 using namespace Urho3D;
 
@@ -58,12 +62,24 @@ private:
     void CreateScene();
     /// Construct instruction text and the login / start server UI.
     void CreateUI();
-    /// Construct the board
-    void CreateBoard();
     /// Set up viewport.
     void SetupViewport();
     /// Subscribe to update, UI and network events.
     void SubscribeToEvents();
+    /// Subscribe to network events only.
+    void SubscribeToNetworkEvents();
+    /// Read the server mode, port and board size from the command line.
+    void ParseArguments(const Vector<String>& arguments);
+    /// Register the server profiler if the metrics or trace output is set.
+    void CreateProfiler();
+    /// Feed the touch journal to the claims as fast as possible, print the result and exit.
+    void Replay();
+    /// Start the server and construct the board.
+    void StartServer();
+    /// Queue the resources of the board to the background loading, so the first connect does not load them on the main thread.
+    void PreloadResources();
+    /// Log the startup stage time since the application creation and write it to the metrics.
+    void ReportStartup(const char* stage, long long usec);
     /// Create a button to the button container.
     Button* CreateButton(const String& text, int width);
     /// Update visibility of buttons according to connection and server status.
@@ -77,14 +93,16 @@ private:
     void HandleStartServer(StringHash eventType, VariantMap& eventData);
     /// Handle connection status change (just update the buttons that should be shown.)
     void HandleConnectionStatus(StringHash eventType, VariantMap& eventData);
-    /// Handle a client connecting to the server.
-    void HandleClientConnected(StringHash eventType, VariantMap& eventData);
+    /// Handle the identity of a connected client, route it to the room.
+    void HandleClientIdentity(StringHash eventType, VariantMap& eventData);
     /// Handle a client disconnecting from the server.
     void HandleClientDisconnected(StringHash eventType, VariantMap& eventData);
+    /// Handle the end of the first frame.
+    void HandleFirstFrame(StringHash eventType, VariantMap& eventData);
+    /// Handle a preloaded resource.
+    void HandleResourceLoaded(StringHash eventType, VariantMap& eventData);
     /// Handle key up event to process key controls
     void HandleKeyUp(StringHash eventType, VariantMap& eventData);
-    /// Handle a client touch
-    void HandleTouchReaction(StringHash eventType, VariantMap& eventData);
 
     /// Button container element.
     SharedPtr<UIElement> buttonContainer_;
@@ -100,18 +118,38 @@ private:
     SharedPtr<Scene> scene_;
     /// Camera scene node.
     SharedPtr<Node> cameraNode_;
-
-    struct ClientResources : public RefCounted
-    {
-        explicit ClientResources(Material * material)
-            : material_(material)
-        {}
-
-        WeakPtr<Material> material_;
-    };
-    using ClientResourcesPtr = SharedPtr<ClientResources>;
-
-    List<ClientResourcesPtr> freeResources_;
-    HashMap<Connection*, ClientResourcesPtr> connectionResources_;
-
+    /// Board rooms of the server.
+    SharedPtr<BoardRooms> rooms_;
+    /// Session of the replayed journal.
+    SharedPtr<BoardSession> session_;
+    /// Run as a headless dedicated server.
+    bool serverMode_;
+    /// UDP port to start the server on or to connect to.
+    unsigned short serverPort_;
+    /// Number of cells along each side of the board.
+    int boardSize_;
+    /// Maximum number of the connected players.
+    unsigned maxPlayers_;
+    /// Server ticks per second.
+    unsigned tickRate_;
+    /// Round length in seconds, zero if the round ends only on the full board.
+    float roundTime_;
+    /// Maximum number of the rooms of the server.
+    unsigned maxRooms_;
+    /// Room of the client, the default room if empty.
+    String roomName_;
+    /// Time since the application creation.
+    HiresTimer startupTimer_;
+    /// Resources still loading in the background.
+    HashSet<StringHash> preloading_;
+    /// File of the server metrics lines, "-" for stdout.
+    String metricsOutput_;
+    /// File of the server Chrome trace.
+    String traceOutput_;
+    /// Memory mapped board file to restore the match from and keep up to date.
+    String snapshotFile_;
+    /// Touch journal to record on the server.
+    String journalFile_;
+    /// Touch journal to replay.
+    String replayFile_;
 };
@@ -0,0 +1,266 @@
+#include "BoardClient.h"
+#include "BoardGrid.h"
+#include "BoardProtocol.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Scene/Scene.h>
+
+BoardClient::BoardClient(Context * context)
+    : Component(context)
+    , authority_(MakeShared<BoardGrid>(context))
+    , sequence_(0)
+    , serverTick_(0)
+    , round_(0)
+    , slot_(NO_OWNER)
+    , view_(IntRect::ZERO)
+    , viewChanged_(false)
+    , resyncing_(false)
+    , interactive_(false)
+{}
+
+void BoardClient::RegisterObject(Context * context)
+{
+    context->RegisterFactory<BoardClient>();
+}
+
+void BoardClient::Predict(unsigned cell, unsigned sequence)
+{
+    auto grid = scene_ ? scene_->GetComponent<BoardGrid>() : nullptr;
+    if(!grid || slot_ == NO_OWNER || grid->GetBusy(cell) || !grid->IsValid(cell) || !IsCellLoaded(cell))
+        return;
+
+    Prediction prediction;
+    prediction.sequence_ = sequence;
+    prediction.cell_ = cell;
+    predictions_.Push(prediction);
+    ++predicted_[cell];
+
+    grid->SetOwner(cell, slot_);
+}
+
+bool BoardClient::IsViewLoaded() const
+{
+    if(loaded_.Empty())
+        return false;
+
+    for(auto y = view_.top_; y <= view_.bottom_; ++y)
+    {
+        for(auto x = view_.left_; x <= view_.right_; ++x)
+        {
+            auto chunk = authority_->GetChunkIndex(IntVector2(x, y));
+            if(chunk < loaded_.Size() && !loaded_[chunk])
+                return false;
+        }
+    }
+    return true;
+}
+
+bool BoardClient::IsCellLoaded(unsigned cell) const
+{
+    auto chunk = authority_->GetChunkIndex(authority_->GetCellChunk(cell));
+    return chunk < loaded_.Size() && loaded_[chunk];
+}
+
+void BoardClient::SetViewRegion(const IntRect & chunks)
+{
+    if(chunks != view_)
+    {
+        view_ = chunks;
+        viewChanged_ = true;
+    }
+}
+
+void BoardClient::OnSceneSet(Scene * scene)
+{
+    if(scene)
+    {
+        scene_ = GetScene();
+        SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(BoardClient, HandleNetworkMessage));
+        SubscribeToEvent(E_SERVERDISCONNECTED, URHO3D_HANDLER(BoardClient, HandleServerDisconnected));
+        SubscribeToEvent(E_NETWORKUPDATE, [this](StringHash, VariantMap &)
+        {
+            SendViewRegion();
+        });
+    }
+    else
+        UnsubscribeFromAllEvents();
+}
+
+void BoardClient::HandleNetworkMessage(StringHash eventType, VariantMap & eventData)
+{
+    using namespace NetworkMessage;
+
+    MemoryBuffer message(eventData[P_DATA].GetBuffer());
+    switch(eventData[P_MESSAGEID].GetInt())
+    {
+    case MSG_BOARD_SNAPSHOT:
+        {
+            Reset();
+            if(!ReadBoardHeader(message, *authority_, sequence_, round_))
+                URHO3D_LOGERROR("Malformed board header");
+
+            // The board is free until the chunks arrive
+            auto grid = scene_->GetOrCreateComponent<BoardGrid>(LOCAL);
+            if(grid->GetSizeAttr() != authority_->GetSizeAttr())
+                grid->SetSize(authority_->GetWidth(), authority_->GetHeight());
+            for(unsigned cell = 0; cell < grid->GetNumCells(); ++cell)
+                grid->SetOwner(cell, NO_OWNER);
+            authority_->ClearDirty();
+
+            auto numChunks = authority_->GetNumChunks();
+            loaded_.Resize(numChunks.x_ * numChunks.y_);
+            for(auto & loaded : loaded_)
+                loaded = false;
+            joinTimer_.Reset();
+            interactive_ = false;
+
+            // The server streams the chunks in the row order until it knows the view
+            viewChanged_ = true;
+        }
+        break;
+
+    case MSG_BOARD_DELTA:
+        {
+            // The deltas sent before the resync apply to the board the client failed to decode
+            if(resyncing_)
+                break;
+
+            // A malformed delta may be partly read, the sequence stays and the server sends the whole board again
+            unsigned sequence = 0;
+            if(!ReadBoardDelta(message, *authority_, sequence, serverTick_))
+            {
+                URHO3D_LOGERRORF("Malformed board delta %u, requesting the board again", sequence_);
+                RequestResync();
+                break;
+            }
+
+            if(sequence != sequence_)
+                URHO3D_LOGWARNINGF("Board delta %u received, %u expected", sequence, sequence_);
+            sequence_ = sequence + 1;
+            ApplyAuthority();
+        }
+        break;
+
+    case MSG_BOARD_CHUNKS:
+        {
+            chunks_.Clear();
+            if(!ReadBoardChunks(message, *authority_, chunks_))
+                URHO3D_LOGERROR("Malformed board chunks");
+            for(auto chunk : chunks_)
+                loaded_[chunk] = true;
+            ApplyAuthority();
+
+            if(!interactive_ && IsViewLoaded())
+            {
+                interactive_ = true;
+                URHO3D_LOGINFOF("Board view loaded in %u ms after the join", joinTimer_.GetMSec(false));
+            }
+        }
+        break;
+
+    case MSG_BOARD_RESET:
+        {
+            // One message for the whole board, the owned cells become dirty and the view recolors only them
+            round_ = message.ReadVLE();
+            for(unsigned cell = 0; cell < authority_->GetNumCells(); ++cell)
+                authority_->SetOwner(cell, NO_OWNER);
+            ApplyAuthority();
+        }
+        break;
+
+    case MSG_PLAYER_SLOT:
+        slot_ = message.ReadUByte();
+        break;
+
+    case MSG_TOUCH_ACK:
+        {
+            auto sequence = message.ReadVLE();
+            serverTick_ = message.ReadVLE();
+            Acknowledge(sequence);
+        }
+        break;
+    }
+}
+
+void BoardClient::HandleServerDisconnected(StringHash eventType, VariantMap & eventData)
+{
+    Reset();
+    slot_ = NO_OWNER;
+    view_ = IntRect::ZERO;
+    viewChanged_ = false;
+    scene_->RemoveComponent<BoardGrid>();
+}
+
+void BoardClient::SendViewRegion()
+{
+    auto connection = GetSubsystem<Network>()->GetServerConnection();
+    if(!connection || !viewChanged_ || !authority_->GetNumCells())
+        return;
+
+    message_.Clear();
+    WriteViewRegion(message_, view_);
+    connection->SendMessage(MSG_VIEW_REGION, true, true, message_);
+    viewChanged_ = false;
+}
+
+void BoardClient::RequestResync()
+{
+    auto connection = GetSubsystem<Network>()->GetServerConnection();
+    if(!connection)
+        return;
+
+    // Reliable and ordered, the server answers after the messages it has already sent
+    message_.Clear();
+    connection->SendMessage(MSG_BOARD_RESYNC, true, true, message_);
+    resyncing_ = true;
+}
+
+void BoardClient::Acknowledge(unsigned sequence)
+{
+    auto grid = scene_->GetComponent<BoardGrid>();
+
+    // The deltas of the tick are sent before the acknowledgement, so the authority already has the result
+    unsigned count = 0;
+    for(; count < predictions_.Size() && predictions_[count].sequence_ < sequence; ++count)
+    {
+        auto cell = predictions_[count].cell_;
+        auto it = predicted_.Find(cell);
+        if(it != predicted_.End() && !--it->second_)
+            predicted_.Erase(it);
+        if(grid)
+            Refresh(grid, cell);
+    }
+    predictions_.Erase(0, count);
+}
+
+void BoardClient::ApplyAuthority()
+{
+    if(auto grid = scene_->GetComponent<BoardGrid>())
+    {
+        for(auto cell : authority_->GetDirtyCells())
+            Refresh(grid, cell);
+    }
+    authority_->ClearDirty();
+}
+
+void BoardClient::Refresh(BoardGrid * grid, unsigned cell)
+{
+    auto owner = authority_->GetOwner(cell);
+    if(owner == NO_OWNER && predicted_.Contains(cell))
+        owner = slot_;
+    grid->SetOwner(cell, owner);
+}
+
+void BoardClient::Reset()
+{
+    predictions_.Clear();
+    predicted_.Clear();
+    authority_->SetSize(0, 0);
+    loaded_.Clear();
+    resyncing_ = false;
+}
@@ -0,0 +1,102 @@
+#ifndef _BOARD_CLIENT_H_INCLUDED__
+#define _BOARD_CLIENT_H_INCLUDED__
+
+#include <Urho3D/Scene/Component.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class Scene;
+}
+
+class BoardGrid;
+
+/// Receives the board header, chunks and deltas from the server and applies them to the local BoardGrid.
+/// The local grid also shows the own claims predicted before the server confirms them.
+/// The chunks arrive over several updates after the join, the board is interactive once the chunks in the view are loaded.
+class BoardClient : public Component
+{
+    URHO3D_OBJECT(BoardClient, Component);
+
+public:
+
+    explicit BoardClient(Context * context);
+    static void RegisterObject(Context * context);
+
+    /// Show the cell claimed by the own touch until the server processes the touch.
+    void Predict(unsigned cell, unsigned sequence);
+    /// Set the inclusive rectangle of the board chunks the camera sees, sent to the server on the next network update.
+    void SetViewRegion(const IntRect & chunks);
+    /// Return true if the chunks in the view are received.
+    bool IsViewLoaded() const;
+    /// Return true if the chunk of the cell is received.
+    bool IsCellLoaded(unsigned cell) const;
+    /// Return the number of the current round.
+    unsigned GetRound() const { return round_; }
+    /// Return the server tick of the last received delta or acknowledgement.
+    unsigned GetServerTick() const { return serverTick_; }
+    /// Return the own player slot, NO_OWNER until the server sends it.
+    unsigned char GetSlot() const { return slot_; }
+
+protected:
+
+    void OnSceneSet(Scene * scene);
+
+private:
+
+    void HandleNetworkMessage(StringHash eventType, VariantMap & eventData);
+    void HandleServerDisconnected(StringHash eventType, VariantMap & eventData);
+    void SendViewRegion();
+    /// Ask the server for the whole board after a malformed delta.
+    void RequestResync();
+    /// Drop the predictions of the touches processed by the server.
+    void Acknowledge(unsigned sequence);
+    /// Copy the cells changed by the server to the local grid.
+    void ApplyAuthority();
+    /// Show the server owner of the cell, or the own slot if the cell is free and predicted.
+    void Refresh(BoardGrid * grid, unsigned cell);
+    void Reset();
+
+private:
+
+    struct Prediction
+    {
+        unsigned sequence_;
+        unsigned cell_;
+    };
+
+    WeakPtr<Scene> scene_;
+    /// Board state as the server sent it.
+    SharedPtr<BoardGrid> authority_;
+    /// Predicted claims ordered by the touch sequence.
+    PODVector<Prediction> predictions_;
+    /// Number of the predictions of the cell.
+    HashMap<unsigned, unsigned> predicted_;
+    /// Sequence number of the next expected delta.
+    unsigned sequence_;
+    unsigned serverTick_;
+    unsigned round_;
+    unsigned char slot_;
+    /// Chunks the camera sees.
+    IntRect view_;
+    /// Whether the view has changed since it was sent.
+    bool viewChanged_;
+    /// Whether the deltas are dropped until the board header requested by RequestResync.
+    bool resyncing_;
+    /// Received flag of every chunk.
+    PODVector<bool> loaded_;
+    /// Received chunks of the last message.
+    PODVector<unsigned> chunks_;
+    /// Time since the board header.
+    Timer joinTimer_;
+    /// Whether the time to the loaded view is logged.
+    bool interactive_;
+    /// Message buffer.
+    VectorBuffer message_;
+};
+
+#endif // _BOARD_CLIENT_H_INCLUDED__
@@ -0,0 +1,238 @@
+#include "BoardGrid.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Math/Ray.h>
+
+BoardGrid::BoardGrid(Context * context)
+    : Component(context)
+    , width_(0)
+    , height_(0)
+{}
+
+void BoardGrid::RegisterObject(Context * context)
+{
+    context->RegisterFactory<BoardGrid>();
+
+    URHO3D_ACCESSOR_ATTRIBUTE("Size", GetSizeAttr, SetSizeAttr, IntVector2, IntVector2::ZERO, AM_FILE);
+    URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Cells", GetCellsAttr, SetCellsAttr, PODVector<unsigned char>, Variant::emptyBuffer, AM_FILE | AM_NOEDIT);
+}
+
+void BoardGrid::SetSize(int width, int height)
+{
+    width_ = Max(width, 0);
+    height_ = Max(height, 0);
+
+    cells_.Resize(width_ * height_);
+    if(cells_.Size())
+        memset(&cells_[0], NO_OWNER, cells_.Size());
+
+    dirtyBits_.Resize((cells_.Size() + 31) / 32);
+    if(dirtyBits_.Size())
+        memset(&dirtyBits_[0], 0, dirtyBits_.Size() * sizeof(unsigned));
+    dirty_.Clear();
+}
+
+bool BoardGrid::Claim(unsigned cell, unsigned char owner)
+{
+    if(!IsValid(cell) || cells_[cell] != NO_OWNER)
+        return false;
+
+    SetOwner(cell, owner);
+    return true;
+}
+
+void BoardGrid::SetOwner(unsigned cell, unsigned char owner)
+{
+    if(!IsValid(cell) || cells_[cell] == owner)
+        return;
+
+    cells_[cell] = owner;
+    MarkDirty(cell);
+}
+
+void BoardGrid::ResetCells(const PODVector<unsigned> & cells)
+{
+    for(auto cell : cells)
+    {
+        if(IsValid(cell))
+            cells_[cell] = NO_OWNER;
+    }
+    ClearDirty();
+}
+
+unsigned char BoardGrid::GetOwner(unsigned cell) const
+{
+    return IsValid(cell) ? cells_[cell] : NO_OWNER;
+}
+
+bool BoardGrid::GetBusy(unsigned cell) const
+{
+    return GetOwner(cell) != NO_OWNER;
+}
+
+unsigned BoardGrid::GetCellIndex(int x, int y) const
+{
+    if(x < 0 || y < 0 || x >= width_ || y >= height_)
+        return M_MAX_UNSIGNED;
+    return static_cast<unsigned>(y * width_ + x);
+}
+
+IntVector2 BoardGrid::GetCellCoords(unsigned cell) const
+{
+    return width_ ? IntVector2(cell % width_, cell / width_) : IntVector2::ZERO;
+}
+
+IntVector2 BoardGrid::GetNumChunks() const
+{
+    return IntVector2((width_ + CHUNK_SIZE - 1) / CHUNK_SIZE, (height_ + CHUNK_SIZE - 1) / CHUNK_SIZE);
+}
+
+IntVector2 BoardGrid::GetCellChunk(unsigned cell) const
+{
+    auto coords = GetCellCoords(cell);
+    return IntVector2(coords.x_ / CHUNK_SIZE, coords.y_ / CHUNK_SIZE);
+}
+
+unsigned BoardGrid::GetChunkIndex(const IntVector2 & chunk) const
+{
+    return static_cast<unsigned>(chunk.y_ * GetNumChunks().x_ + chunk.x_);
+}
+
+IntVector2 BoardGrid::GetChunkCoords(unsigned chunk) const
+{
+    auto numChunksX = GetNumChunks().x_;
+    return numChunksX ? IntVector2(chunk % numChunksX, chunk / numChunksX) : IntVector2::ZERO;
+}
+
+void BoardGrid::GetChunkCells(const IntVector2 & chunk, PODVector<unsigned> & cells) const
+{
+    auto maxX = Min((chunk.x_ + 1) * CHUNK_SIZE, width_);
+    auto maxY = Min((chunk.y_ + 1) * CHUNK_SIZE, height_);
+    for(auto y = chunk.y_ * CHUNK_SIZE; y < maxY; ++y)
+    {
+        for(auto x = chunk.x_ * CHUNK_SIZE; x < maxX; ++x)
+            cells.Push(GetCellIndex(x, y));
+    }
+}
+
+IntVector2 BoardGrid::GetCellAt(const Vector3 & position) const
+{
+    return IntVector2(static_cast<int>(floorf(position.x_ / CELL_SPACING + 0.5f)) + width_ / 2,
+        static_cast<int>(floorf(position.z_ / CELL_SPACING + 0.5f)) + height_ / 2);
+}
+
+Vector3 BoardGrid::GetCellPosition(unsigned cell) const
+{
+    auto coords = GetCellCoords(cell);
+    return Vector3((coords.x_ - width_ / 2) * CELL_SPACING, 0.0f, (coords.y_ - height_ / 2) * CELL_SPACING);
+}
+
+BoundingBox BoardGrid::GetCellBox(unsigned cell) const
+{
+    auto center = GetCellPosition(cell);
+    return BoundingBox(center - CELL_SCALE * 0.5f, center + CELL_SCALE * 0.5f);
+}
+
+bool BoardGrid::Raycast(const Ray & ray, unsigned & cell, float & distance) const
+{
+    cell = M_MAX_UNSIGNED;
+    distance = M_INFINITY;
+
+    if(Abs(ray.direction_.y_) < M_EPSILON)
+        return false;
+
+    // Part of the ray inside the slab of the cell boxes
+    auto halfHeight = CELL_SCALE.y_ * 0.5f;
+    auto top = (halfHeight - ray.origin_.y_) / ray.direction_.y_;
+    auto bottom = (-halfHeight - ray.origin_.y_) / ray.direction_.y_;
+    auto enter = Max(Min(top, bottom), 0.0f);
+    auto exit = Max(top, bottom);
+    if(exit < 0.0f)
+        return true;
+
+    auto a = ray.origin_ + ray.direction_ * enter;
+    auto b = ray.origin_ + ray.direction_ * exit;
+
+    // Range of the cells whose boxes overlap the crossed part
+    auto halfX = CELL_SCALE.x_ * 0.5f;
+    auto halfZ = CELL_SCALE.z_ * 0.5f;
+    auto minX = Max(static_cast<int>(ceilf((Min(a.x_, b.x_) - halfX) / CELL_SPACING)) + width_ / 2, 0);
+    auto maxX = Min(static_cast<int>(floorf((Max(a.x_, b.x_) + halfX) / CELL_SPACING)) + width_ / 2, width_ - 1);
+    auto minY = Max(static_cast<int>(ceilf((Min(a.z_, b.z_) - halfZ) / CELL_SPACING)) + height_ / 2, 0);
+    auto maxY = Min(static_cast<int>(floorf((Max(a.z_, b.z_) + halfZ) / CELL_SPACING)) + height_ / 2, height_ - 1);
+    if(minX > maxX || minY > maxY)
+        return true;
+
+    if((maxX - minX + 1) * (maxY - minY + 1) > MAX_RAYCAST_CELLS)
+        return false;
+
+    for(auto y = minY; y <= maxY; ++y)
+    {
+        for(auto x = minX; x <= maxX; ++x)
+        {
+            auto index = GetCellIndex(x, y);
+            auto hit = ray.HitDistance(GetCellBox(index));
+            if(hit < distance)
+            {
+                distance = hit;
+                cell = index;
+            }
+        }
+    }
+
+    return true;
+}
+
+void BoardGrid::ClearDirty()
+{
+    for(auto cell : dirty_)
+        dirtyBits_[cell >> 5] &= ~(1u << (cell & 31));
+    dirty_.Clear();
+}
+
+void BoardGrid::SetSizeAttr(const IntVector2& size)
+{
+    if(size.x_ != width_ || size.y_ != height_)
+        SetSize(size.x_, size.y_);
+}
+
+IntVector2 BoardGrid::GetSizeAttr() const
+{
+    return IntVector2(width_, height_);
+}
+
+void BoardGrid::SetCellsAttr(const PODVector<unsigned char>& cells)
+{
+    if(cells.Size() != cells_.Size())
+        return;
+
+    for(unsigned i = 0; i < cells.Size(); ++i)
+    {
+        if(cells_[i] != cells[i])
+        {
+            cells_[i] = cells[i];
+            MarkDirty(i);
+        }
+    }
+}
+
+unsigned BoardGrid::GetMemoryUse() const
+{
+    return cells_.Capacity() + (dirtyBits_.Capacity() + dirty_.Capacity()) * sizeof(unsigned);
+}
+
+const PODVector<unsigned char>& BoardGrid::GetCellsAttr() const
+{
+    return cells_;
+}
+
+void BoardGrid::MarkDirty(unsigned cell)
+{
+    auto & bits = dirtyBits_[cell >> 5];
+    auto mask = 1u << (cell & 31);
+    if(!(bits & mask))
+    {
+        bits |= mask;
+        dirty_.Push(cell);
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef _BOARD_GRID_H_INCLUDED__
+#define _BOARD_GRID_H_INCLUDED__
+
+#include <Urho3D/Math/BoundingBox.h>
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class Ray;
+}
+
+/// Owner value of a free cell.
+static const unsigned char NO_OWNER = 0;
+/// Distance between the centers of the neighbour cells.
+static const float CELL_SPACING = 1.6f;
+/// Size of a cell box.
+static const Vector3 CELL_SCALE(1.5f, 0.5f, 1.5f);
+/// Maximum number of the cell boxes tested by the analytic raycast.
+static const int MAX_RAYCAST_CELLS = 16;
+/// Side of a square board chunk in cells, the unit of the client interest.
+static const int CHUNK_SIZE = 16;
+
+/// Packed owner/busy state of the whole board, one byte per cell indexed by y * width + x.
+class BoardGrid : public Component
+{
+    URHO3D_OBJECT(BoardGrid, Component);
+
+public:
+
+    explicit BoardGrid(Context * context);
+    static void RegisterObject(Context * context);
+
+    /// Resize the board and release all the cells.
+    void SetSize(int width, int height);
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    unsigned GetNumCells() const { return cells_.Size(); }
+
+    /// Claim a free cell. Return false if the cell is out of range or already busy.
+    bool Claim(unsigned cell, unsigned char owner);
+    /// Set the cell owner unconditionally, NO_OWNER releases the cell.
+    void SetOwner(unsigned cell, unsigned char owner);
+    /// Release the cells and drop the dirty list without marking them, for a reset sent to the clients as a whole.
+    void ResetCells(const PODVector<unsigned> & cells);
+    unsigned char GetOwner(unsigned cell) const;
+    bool GetBusy(unsigned cell) const;
+    bool IsValid(unsigned cell) const { return cell < cells_.Size(); }
+
+    /// Return cell index by coordinates or M_MAX_UNSIGNED if outside of the board.
+    unsigned GetCellIndex(int x, int y) const;
+    IntVector2 GetCellCoords(unsigned cell) const;
+    /// Return the number of the chunks along the sides of the board.
+    IntVector2 GetNumChunks() const;
+    /// Return the chunk coordinates of the cell.
+    IntVector2 GetCellChunk(unsigned cell) const;
+    /// Return the chunk index by the chunk coordinates, chunks are indexed by y * chunks along x + x.
+    unsigned GetChunkIndex(const IntVector2 & chunk) const;
+    IntVector2 GetChunkCoords(unsigned chunk) const;
+    /// Append the cells of the chunk.
+    void GetChunkCells(const IntVector2 & chunk, PODVector<unsigned> & cells) const;
+    /// Return the cell coordinates of the node space position, not clamped to the board.
+    IntVector2 GetCellAt(const Vector3 & position) const;
+
+    /// Return the cell center in the node space.
+    Vector3 GetCellPosition(unsigned cell) const;
+    /// Return the cell box in the node space.
+    BoundingBox GetCellBox(unsigned cell) const;
+    /// Intersect the ray in the node space with the board slab and test only the boxes of the cells under the crossed part.
+    /// Return false if the ray is too flat to resolve it this way, otherwise the hit cell (M_MAX_UNSIGNED on miss) and distance.
+    bool Raycast(const Ray & ray, unsigned & cell, float & distance) const;
+
+    /// Return the cells changed since the last ClearDirty.
+    const PODVector<unsigned>& GetDirtyCells() const { return dirty_; }
+    void ClearDirty();
+
+    void SetSizeAttr(const IntVector2& size);
+    IntVector2 GetSizeAttr() const;
+    void SetCellsAttr(const PODVector<unsigned char>& cells);
+    const PODVector<unsigned char>& GetCellsAttr() const;
+
+    /// Return the bytes held by the cells and the dirty tracking.
+    unsigned GetMemoryUse() const;
+
+private:
+
+    void MarkDirty(unsigned cell);
+
+private:
+
+    int width_;
+    int height_;
+    /// Owner of each cell.
+    PODVector<unsigned char> cells_;
+    /// One bit per cell, set while the cell is in the dirty list.
+    PODVector<unsigned> dirtyBits_;
+    /// Changed cells.
+    PODVector<unsigned> dirty_;
+};
+
+#endif // _BOARD_GRID_H_INCLUDED__
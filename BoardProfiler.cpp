@@ -0,0 +1,218 @@
+#include "BoardProfiler.h"
+#include "StringFormat.h"
+
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+
+namespace
+{
+    const char * SECTION_NAMES[] = { "touches", "claims", "replication" };
+    const char * QUEUE_NAMES[] = { "touches", "claims" };
+
+    float ToMilliseconds(long long usec)
+    {
+        return usec / 1000.0f;
+    }
+}
+
+BoardProfiler::BoardProfiler(Context * context)
+    : Object(context)
+    , tickBegin_(0)
+    , ticks_(0)
+    , overruns_(0)
+    , tickTotal_(0)
+    , tickMax_(0)
+    , touches_(0)
+    , dropped_(0)
+    , claims_(0)
+    , rejected_(0)
+    , intervalBegin_(0)
+    , metricsToStdout_(false)
+    , firstTraceEvent_(true)
+{
+    for(auto & section : sections_)
+    {
+        section.tick_ = section.total_ = section.max_ = 0;
+        section.begin_ = -1;
+    }
+    for(auto & queue : queues_)
+        queue = 0;
+}
+
+BoardProfiler::~BoardProfiler()
+{
+    // The trace viewer accepts an unterminated array, but close it when possible
+    if(trace_)
+        trace_->WriteLine("\n]");
+}
+
+bool BoardProfiler::SetMetricsOutput(const String & fileName)
+{
+    metrics_.Reset();
+    metricsToStdout_ = fileName == "-";
+    if(metricsToStdout_ || fileName.Empty())
+        return true;
+
+    metrics_ = MakeShared<File>(context_, fileName, FILE_WRITE);
+    if(!metrics_->IsOpen())
+    {
+        URHO3D_LOGERRORF("Can not open the metrics file %s", fileName.CString());
+        metrics_.Reset();
+        return false;
+    }
+    return true;
+}
+
+bool BoardProfiler::SetTraceOutput(const String & fileName)
+{
+    trace_.Reset();
+    if(fileName.Empty())
+        return true;
+
+    trace_ = MakeShared<File>(context_, fileName, FILE_WRITE);
+    if(!trace_->IsOpen())
+    {
+        URHO3D_LOGERRORF("Can not open the trace file %s", fileName.CString());
+        trace_.Reset();
+        return false;
+    }
+
+    trace_->Write("[", 1);
+    firstTraceEvent_ = true;
+    return true;
+}
+
+void BoardProfiler::BeginSection(ProfileSection section)
+{
+    auto & stats = sections_[section];
+    if(stats.begin_ < 0)
+        stats.begin_ = clock_.GetUSec(false);
+}
+
+void BoardProfiler::EndSection(ProfileSection section)
+{
+    auto & stats = sections_[section];
+    if(stats.begin_ < 0)
+        return;
+
+    auto duration = clock_.GetUSec(false) - stats.begin_;
+    stats.tick_ += duration;
+    WriteTraceEvent(SECTION_NAMES[section], stats.begin_, duration);
+    stats.begin_ = -1;
+}
+
+void BoardProfiler::AddClaims(unsigned numWon, unsigned numRejected)
+{
+    claims_ += numWon;
+    rejected_ += numRejected;
+}
+
+void BoardProfiler::AddBytesSent(Connection * connection, unsigned bytes)
+{
+    bytesSent_[connection] += bytes;
+}
+
+void BoardProfiler::SetQueueDepth(ProfileQueue queue, unsigned depth)
+{
+    queues_[queue] = Max(queues_[queue], depth);
+}
+
+void BoardProfiler::BeginTick()
+{
+    tickBegin_ = clock_.GetUSec(false);
+}
+
+void BoardProfiler::EndTick(float timeStep)
+{
+    // A frame may run several ticks or none, so every tick is timed on its own
+    auto now = clock_.GetUSec(false);
+    auto tick = now - tickBegin_;
+    WriteTraceEvent("tick", tickBegin_, tick);
+
+    ++ticks_;
+    tickTotal_ += tick;
+    tickMax_ = Max(tickMax_, tick);
+
+    // Up to MAX_TICKS_PER_FRAME ticks run back to back, each must fit its own step
+    if(tick > static_cast<long long>(timeStep * 1000000.0f))
+        ++overruns_;
+
+    for(auto & section : sections_)
+    {
+        section.total_ += section.tick_;
+        section.max_ = Max(section.max_, section.tick_);
+        section.tick_ = 0;
+    }
+
+    auto elapsed = (now - intervalBegin_) / 1000000.0f;
+    if(elapsed >= METRICS_INTERVAL)
+    {
+        WriteMetrics(elapsed);
+        intervalBegin_ = now;
+    }
+}
+
+void BoardProfiler::WriteMetrics(float elapsed)
+{
+    if(metrics_ || metricsToStdout_)
+    {
+        unsigned bytesTotal = 0;
+        unsigned bytesMax = 0;
+        for(auto it = bytesSent_.Begin(); it != bytesSent_.End(); ++it)
+        {
+            bytesTotal += it->second_;
+            bytesMax = Max(bytesMax, it->second_);
+        }
+        auto numConnections = bytesSent_.Size();
+        auto ticks = Max(ticks_, 1u);
+
+        auto line = FormatString("{\"ticks\":%u,\"overruns\":%u,\"tick_ms\":{\"avg\":%.3f,\"max\":%.3f}",
+            ticks_, overruns_, ToMilliseconds(tickTotal_ / ticks), ToMilliseconds(tickMax_));
+        for(unsigned i = 0; i < MAX_PROFILE_SECTIONS; ++i)
+        {
+            line += FormatString(",\"%s_ms\":{\"avg\":%.3f,\"max\":%.3f}", SECTION_NAMES[i],
+                ToMilliseconds(sections_[i].total_ / ticks), ToMilliseconds(sections_[i].max_));
+        }
+        line += FormatString(",\"touches_per_s\":%.1f,\"dropped_per_s\":%.1f,\"claims_per_s\":%.1f,\"rejected_per_s\":%.1f",
+            touches_ / elapsed, dropped_ / elapsed, claims_ / elapsed, rejected_ / elapsed);
+        line += FormatString(",\"connections\":%u,\"bytes_per_connection_per_s\":{\"avg\":%.1f,\"max\":%.1f}",
+            numConnections, numConnections ? bytesTotal / elapsed / numConnections : 0.0f, bytesMax / elapsed);
+        line += ",\"queue_max\":{";
+        for(unsigned i = 0; i < MAX_PROFILE_QUEUES; ++i)
+            line.AppendWithFormat("%s\"%s\":%u", i ? "," : "", QUEUE_NAMES[i], queues_[i]);
+        line += "}}";
+        WriteMetricsLine(line);
+    }
+
+    ticks_ = overruns_ = 0;
+    tickTotal_ = tickMax_ = 0;
+    touches_ = dropped_ = claims_ = rejected_ = 0;
+    bytesSent_.Clear();
+    for(auto & section : sections_)
+        section.total_ = section.max_ = 0;
+    for(auto & queue : queues_)
+        queue = 0;
+}
+
+void BoardProfiler::WriteMetricsLine(const String & line)
+{
+    if(metricsToStdout_)
+        PrintLine(line);
+    else if(metrics_)
+    {
+        metrics_->WriteLine(line);
+        metrics_->Flush();
+    }
+}
+
+void BoardProfiler::WriteTraceEvent(const char * name, long long begin, long long duration)
+{
+    if(!trace_)
+        return;
+
+    auto event = FormatString("%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lld,\"dur\":%lld}",
+        firstTraceEvent_ ? "" : ",", name, begin, duration);
+    trace_->Write(event.CString(), event.Length());
+    firstTraceEvent_ = false;
+}
@@ -0,0 +1,143 @@
+#ifndef _BOARD_PROFILER_H_INCLUDED__
+#define _BOARD_PROFILER_H_INCLUDED__
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Container/HashMap.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Connection;
+    class Context;
+    class File;
+}
+
+/// Timed parts of the server tick.
+enum ProfileSection
+{
+    /// Reading the touch batches and dispatching the touches.
+    PROFILE_TOUCHES = 0,
+    /// Resolving the claims.
+    PROFILE_CLAIMS,
+    /// Encoding and sending the board snapshots and deltas.
+    PROFILE_REPLICATION,
+    MAX_PROFILE_SECTIONS
+};
+
+/// Queues sampled every tick, the maximum depth of the interval is reported.
+enum ProfileQueue
+{
+    /// Touches waiting for the dispatch.
+    QUEUE_TOUCHES = 0,
+    /// Claims waiting for the resolution.
+    QUEUE_CLAIMS,
+    MAX_PROFILE_QUEUES
+};
+
+/// Interval of the metrics lines in seconds.
+static const float METRICS_INTERVAL = 1.0f;
+
+/// Server tick instrumentation, registered as a subsystem only when an output is requested.
+/// Times every server tick between BeginTick and EndTick and its sections, counts the touches, claims and bytes sent,
+/// and writes a JSON line of the interval totals every METRICS_INTERVAL. Optionally records the sections as Chrome trace events.
+class BoardProfiler : public Object
+{
+    URHO3D_OBJECT(BoardProfiler, Object);
+
+public:
+
+    explicit BoardProfiler(Context * context);
+    virtual ~BoardProfiler();
+
+    /// Write the metrics lines to the file, "-" writes them to stdout. Return false if the file can not be opened.
+    bool SetMetricsOutput(const String & fileName);
+    /// Write the Chrome trace events (chrome://tracing) to the file. Return false if the file can not be opened.
+    bool SetTraceOutput(const String & fileName);
+
+    /// Start timing the server tick.
+    void BeginTick();
+    /// Stop timing the server tick of the time step and add it to the interval, write the metrics at the end of the interval.
+    /// The ticks longer than the step are the overruns.
+    void EndTick(float timeStep);
+    void BeginSection(ProfileSection section);
+    void EndSection(ProfileSection section);
+
+    void AddTouches(unsigned count) { touches_ += count; }
+    void AddDroppedTouches(unsigned count) { dropped_ += count; }
+    void AddClaims(unsigned numWon, unsigned numRejected);
+    void AddBytesSent(Connection * connection, unsigned bytes);
+    void SetQueueDepth(ProfileQueue queue, unsigned depth);
+    /// Write a JSON line of other metrics, such as the room statistics, to the metrics output.
+    void WriteMetricsLine(const String & line);
+
+private:
+
+    void WriteMetrics(float elapsed);
+    void WriteTraceEvent(const char * name, long long begin, long long duration);
+
+private:
+
+    struct SectionStats
+    {
+        /// Time of the section in the current tick, the sections outside the ticks go to the next one.
+        long long tick_;
+        /// Total and maximum per tick time of the interval.
+        long long total_;
+        long long max_;
+        /// Start of the running section or -1.
+        long long begin_;
+    };
+
+    /// Time since the profiler creation, the trace timestamps.
+    HiresTimer clock_;
+    /// Start of the current tick.
+    long long tickBegin_;
+    SectionStats sections_[MAX_PROFILE_SECTIONS];
+    unsigned queues_[MAX_PROFILE_QUEUES];
+
+    /// Interval totals.
+    unsigned ticks_;
+    unsigned overruns_;
+    long long tickTotal_;
+    long long tickMax_;
+    unsigned touches_;
+    unsigned dropped_;
+    unsigned claims_;
+    unsigned rejected_;
+    HashMap<Connection*, unsigned> bytesSent_;
+    long long intervalBegin_;
+
+    SharedPtr<File> metrics_;
+    bool metricsToStdout_;
+    SharedPtr<File> trace_;
+    bool firstTraceEvent_;
+};
+
+/// Times a section of the tick while in scope, does nothing without the profiler.
+class ProfileBlock
+{
+public:
+
+    ProfileBlock(BoardProfiler * profiler, ProfileSection section)
+        : profiler_(profiler)
+        , section_(section)
+    {
+        if(profiler_)
+            profiler_->BeginSection(section_);
+    }
+
+    ~ProfileBlock()
+    {
+        if(profiler_)
+            profiler_->EndSection(section_);
+    }
+
+private:
+
+    BoardProfiler * profiler_;
+    ProfileSection section_;
+};
+
+#endif // _BOARD_PROFILER_H_INCLUDED__
@@ -0,0 +1,433 @@
+#include "BoardProtocol.h"
+#include "BoardGrid.h"
+
+#include <Urho3D/IO/Deserializer.h>
+#include <Urho3D/IO/Serializer.h>
+
+namespace
+{
+    unsigned ZigZag(int value)
+    {
+        return static_cast<unsigned>(value) << 1 ^ static_cast<unsigned>(value >> 31);
+    }
+
+    int UnZigZag(unsigned value)
+    {
+        return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+    }
+
+    /// Deserializer reads garbage past the end, the truncated messages are caught by these. Return false if the source ran out.
+    bool ReadUByte(Deserializer & source, unsigned char & value)
+    {
+        if(source.IsEof())
+            return false;
+        value = source.ReadUByte();
+        return true;
+    }
+
+    bool ReadUInt(Deserializer & source, unsigned & value)
+    {
+        if(source.GetPosition() + sizeof(unsigned) > source.GetSize())
+            return false;
+        value = source.ReadUInt();
+        return true;
+    }
+
+    /// Read the VLE of Serializer::WriteVLE: 7 bits per byte with the continuation bit, the fourth byte is whole.
+    bool ReadVLE(Deserializer & source, unsigned & value)
+    {
+        value = 0;
+        unsigned char byte;
+        for(unsigned shift = 0; shift < 21; shift += 7)
+        {
+            if(!ReadUByte(source, byte))
+                return false;
+            value |= static_cast<unsigned>(byte & 0x7f) << shift;
+            if(byte < 0x80)
+                return true;
+        }
+
+        if(!ReadUByte(source, byte))
+            return false;
+        value |= static_cast<unsigned>(byte) << 21;
+        return true;
+    }
+
+    /// Return the end of the run of one owner starting at the index.
+    unsigned GetOwnerRunEnd(const BoardGrid & grid, const PODVector<unsigned> & cells, unsigned first)
+    {
+        auto owner = grid.GetOwner(cells[first]);
+        auto i = first + 1;
+        while(i < cells.Size() && grid.GetOwner(cells[i]) == owner)
+            ++i;
+        return i;
+    }
+
+    /// Return the end of the run of the neighbour cells of one owner starting at the index.
+    unsigned GetCellRunEnd(const BoardGrid & grid, const PODVector<unsigned> & cells, unsigned first)
+    {
+        auto owner = grid.GetOwner(cells[first]);
+        auto i = first + 1;
+        while(i < cells.Size() && cells[i] == cells[i - 1] + 1 && grid.GetOwner(cells[i]) == owner)
+            ++i;
+        return i;
+    }
+}
+
+unsigned GetBitsFor(unsigned value)
+{
+    unsigned bits = 1;
+    while(bits < 32 && (value >> bits))
+        ++bits;
+    return bits;
+}
+
+unsigned GetVLESize(unsigned value)
+{
+    if(value < 0x80)
+        return 1;
+    if(value < 0x4000)
+        return 2;
+    if(value < 0x200000)
+        return 3;
+    return 4;
+}
+
+BitWriter::BitWriter(Serializer & dest)
+    : dest_(dest)
+    , bits_(0)
+    , numBits_(0)
+{}
+
+BitWriter::~BitWriter()
+{
+    Flush();
+}
+
+void BitWriter::Write(unsigned value, unsigned bits)
+{
+    bits_ |= static_cast<unsigned long long>(value & (0xffffffffu >> (32 - bits))) << numBits_;
+    numBits_ += bits;
+    while(numBits_ >= 8)
+    {
+        dest_.WriteUByte(static_cast<unsigned char>(bits_ & 0xff));
+        bits_ >>= 8;
+        numBits_ -= 8;
+    }
+}
+
+void BitWriter::Flush()
+{
+    if(numBits_)
+    {
+        dest_.WriteUByte(static_cast<unsigned char>(bits_ & 0xff));
+        bits_ = 0;
+        numBits_ = 0;
+    }
+}
+
+BitReader::BitReader(Deserializer & source)
+    : source_(source)
+    , bits_(0)
+    , numBits_(0)
+    , valid_(true)
+{}
+
+unsigned BitReader::Read(unsigned bits)
+{
+    while(numBits_ < bits)
+    {
+        if(source_.IsEof())
+        {
+            valid_ = false;
+            return 0;
+        }
+        bits_ |= static_cast<unsigned long long>(source_.ReadUByte()) << numBits_;
+        numBits_ += 8;
+    }
+
+    auto value = static_cast<unsigned>(bits_ & (0xffffffffu >> (32 - bits)));
+    bits_ >>= bits;
+    numBits_ -= bits;
+    return value;
+}
+
+void WriteBoardHeader(Serializer & dest, const BoardGrid & grid, unsigned sequence, unsigned round)
+{
+    dest.WriteVLE(grid.GetWidth());
+    dest.WriteVLE(grid.GetHeight());
+    dest.WriteVLE(sequence);
+    dest.WriteVLE(round);
+}
+
+bool ReadBoardHeader(Deserializer & source, BoardGrid & grid, unsigned & sequence, unsigned & round)
+{
+    unsigned width, height;
+    if(!ReadVLE(source, width) || !ReadVLE(source, height) || !ReadVLE(source, sequence) || !ReadVLE(source, round))
+        return false;
+    if(static_cast<int>(width) < 0 || static_cast<int>(height) < 0)
+        return false;
+
+    if(width != grid.GetWidth() || height != grid.GetHeight())
+        grid.SetSize(width, height);
+    else
+    {
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+            grid.SetOwner(cell, NO_OWNER);
+    }
+
+    return true;
+}
+
+void WriteBoardChunks(Serializer & dest, const BoardGrid & grid, const PODVector<unsigned> & chunks)
+{
+    PODVector<unsigned> cells;
+    for(auto chunk : chunks)
+        grid.GetChunkCells(grid.GetChunkCoords(chunk), cells);
+
+    // The claimed territories and the free board are long runs of one owner
+    unsigned char maxOwner = NO_OWNER;
+    unsigned numRuns = 0;
+    unsigned runBytes = 0;
+    for(unsigned i = 0; i < cells.Size();)
+    {
+        auto end = GetOwnerRunEnd(grid, cells, i);
+        maxOwner = Max(maxOwner, grid.GetOwner(cells[i]));
+        runBytes += GetVLESize(end - i - 1);
+        ++numRuns;
+        i = end;
+    }
+    auto ownerBits = GetBitsFor(maxOwner);
+    auto useRuns = GetVLESize(numRuns) + runBytes + (numRuns * ownerBits + 7) / 8 < (cells.Size() * ownerBits + 7) / 8;
+
+    dest.WriteVLE(chunks.Size());
+    for(auto chunk : chunks)
+        dest.WriteVLE(chunk);
+
+    if(!useRuns)
+    {
+        dest.WriteUByte(ownerBits);
+        BitWriter writer(dest);
+        for(auto cell : cells)
+            writer.Write(grid.GetOwner(cell), ownerBits);
+        return;
+    }
+
+    dest.WriteUByte(ownerBits | OWNER_RUNS_FLAG);
+    dest.WriteVLE(numRuns);
+    for(unsigned i = 0; i < cells.Size();)
+    {
+        auto end = GetOwnerRunEnd(grid, cells, i);
+        dest.WriteVLE(end - i - 1);
+        i = end;
+    }
+
+    BitWriter writer(dest);
+    for(unsigned i = 0; i < cells.Size(); i = GetOwnerRunEnd(grid, cells, i))
+        writer.Write(grid.GetOwner(cells[i]), ownerBits);
+}
+
+bool ReadBoardChunks(Deserializer & source, BoardGrid & grid, PODVector<unsigned> & chunks)
+{
+    auto numChunks = grid.GetNumChunks();
+    unsigned count;
+    if(!ReadVLE(source, count))
+        return false;
+    auto first = chunks.Size();
+    for(unsigned i = 0; i < count; ++i)
+    {
+        unsigned chunk;
+        if(!ReadVLE(source, chunk) || chunk >= static_cast<unsigned>(numChunks.x_ * numChunks.y_))
+            return false;
+        chunks.Push(chunk);
+    }
+
+    unsigned char ownerBits;
+    if(!ReadUByte(source, ownerBits))
+        return false;
+    auto useRuns = (ownerBits & OWNER_RUNS_FLAG) != 0;
+    ownerBits &= ~OWNER_RUNS_FLAG;
+    if(!ownerBits || ownerBits > 8)
+        return false;
+
+    PODVector<unsigned> cells;
+    for(unsigned i = first; i < chunks.Size(); ++i)
+        grid.GetChunkCells(grid.GetChunkCoords(chunks[i]), cells);
+
+    if(!useRuns)
+    {
+        BitReader reader(source);
+        for(auto cell : cells)
+        {
+            auto owner = reader.Read(ownerBits);
+            if(!reader.IsValid())
+                return false;
+            grid.SetOwner(cell, static_cast<unsigned char>(owner));
+        }
+        return true;
+    }
+
+    unsigned numRuns;
+    if(!ReadVLE(source, numRuns) || numRuns > cells.Size())
+        return false;
+
+    PODVector<unsigned> lengths(numRuns);
+    unsigned numCells = 0;
+    for(auto & length : lengths)
+    {
+        if(!ReadVLE(source, length) || length >= cells.Size() - numCells)
+            return false;
+        ++length;
+        numCells += length;
+    }
+    if(numCells != cells.Size())
+        return false;
+
+    BitReader reader(source);
+    unsigned i = 0;
+    for(auto length : lengths)
+    {
+        auto owner = reader.Read(ownerBits);
+        if(!reader.IsValid())
+            return false;
+        for(auto end = i + length; i < end; ++i)
+            grid.SetOwner(cells[i], static_cast<unsigned char>(owner));
+    }
+
+    return true;
+}
+
+void WriteBoardDelta(Serializer & dest, const BoardGrid & grid, const PODVector<unsigned> & cells, unsigned sequence, unsigned tick)
+{
+    // A run is the neighbour cells in the index order claimed by one owner
+    unsigned char maxOwner = NO_OWNER;
+    unsigned numRuns = 0;
+    for(unsigned i = 0; i < cells.Size(); i = GetCellRunEnd(grid, cells, i))
+    {
+        maxOwner = Max(maxOwner, grid.GetOwner(cells[i]));
+        ++numRuns;
+    }
+    auto ownerBits = GetBitsFor(maxOwner);
+
+    dest.WriteVLE(sequence);
+    dest.WriteVLE(tick);
+    dest.WriteVLE(numRuns);
+    dest.WriteUByte(ownerBits);
+
+    unsigned last = 0;
+    for(unsigned i = 0; i < cells.Size();)
+    {
+        auto end = GetCellRunEnd(grid, cells, i);
+        auto gap = cells[i] - last;
+        auto length = end - i;
+        dest.WriteVLE(gap << 1 | (length > 1 ? 1 : 0));
+        if(length > 1)
+            dest.WriteVLE(length - 2);
+        last = cells[end - 1] + 1;
+        i = end;
+    }
+
+    BitWriter writer(dest);
+    for(unsigned i = 0; i < cells.Size(); i = GetCellRunEnd(grid, cells, i))
+        writer.Write(grid.GetOwner(cells[i]), ownerBits);
+}
+
+bool ReadBoardDelta(Deserializer & source, BoardGrid & grid, unsigned & sequence, unsigned & tick)
+{
+    unsigned numRuns;
+    unsigned char ownerBits;
+    if(!ReadVLE(source, sequence) || !ReadVLE(source, tick) || !ReadVLE(source, numRuns) || !ReadUByte(source, ownerBits))
+        return false;
+    if(!ownerBits || ownerBits > 8 || numRuns > grid.GetNumCells())
+        return false;
+
+    // The runs go first, the owners follow packed
+    PODVector<unsigned> runs(numRuns * 2);
+    unsigned end = 0;
+    for(unsigned i = 0; i < numRuns; ++i)
+    {
+        unsigned gap;
+        unsigned length = 0;
+        if(!ReadVLE(source, gap) || ((gap & 1) && !ReadVLE(source, length)))
+            return false;
+        length = gap & 1 ? length + 2 : 1;
+        if((gap >> 1) > grid.GetNumCells() - end || length > grid.GetNumCells() - end - (gap >> 1))
+            return false;
+
+        runs[i * 2] = end + (gap >> 1);
+        runs[i * 2 + 1] = length;
+        end = runs[i * 2] + length;
+    }
+
+    BitReader reader(source);
+    for(unsigned i = 0; i < numRuns; ++i)
+    {
+        auto owner = reader.Read(ownerBits);
+        if(!reader.IsValid())
+            return false;
+        for(unsigned cell = runs[i * 2]; cell < runs[i * 2] + runs[i * 2 + 1]; ++cell)
+            grid.SetOwner(cell, static_cast<unsigned char>(owner));
+    }
+
+    return true;
+}
+
+void WriteTouchBatch(Serializer & dest, const PODVector<TouchData> & touches)
+{
+    auto sequence = touches.Size() ? touches.Front().sequence_ : 0;
+    auto time = touches.Size() ? touches.Front().time_ : 0;
+
+    dest.WriteVLE(sequence);
+    dest.WriteVLE(touches.Size());
+    dest.WriteUInt(time);
+    unsigned cell = 0;
+    for(auto & touch : touches)
+    {
+        dest.WriteVLE(ZigZag(static_cast<int>(touch.cell_ - cell)));
+        dest.WriteVLE(touch.time_ - time);
+        cell = touch.cell_;
+    }
+}
+
+bool ReadTouchBatch(Deserializer & source, PODVector<TouchData> & touches)
+{
+    unsigned sequence, count, time;
+    if(!ReadVLE(source, sequence) || !ReadVLE(source, count) || !ReadUInt(source, time))
+        return false;
+
+    unsigned cell = 0;
+    for(unsigned i = 0; i < count; ++i)
+    {
+        unsigned delta, offset;
+        if(!ReadVLE(source, delta) || !ReadVLE(source, offset))
+            return false;
+
+        cell += static_cast<unsigned>(UnZigZag(delta));
+        TouchData touch;
+        touch.cell_ = cell;
+        touch.time_ = time + offset;
+        touch.sequence_ = sequence + i;
+        touches.Push(touch);
+    }
+
+    return true;
+}
+
+void WriteViewRegion(Serializer & dest, const IntRect & chunks)
+{
+    dest.WriteVLE(chunks.left_);
+    dest.WriteVLE(chunks.top_);
+    dest.WriteVLE(chunks.right_);
+    dest.WriteVLE(chunks.bottom_);
+}
+
+bool ReadViewRegion(Deserializer & source, IntRect & chunks)
+{
+    unsigned left, top, right, bottom;
+    if(!ReadVLE(source, left) || !ReadVLE(source, top) || !ReadVLE(source, right) || !ReadVLE(source, bottom))
+        return false;
+
+    // The VLE is at most 29 bits, the coordinates are never negative
+    chunks = IntRect(left, top, right, bottom);
+    return true;
+}
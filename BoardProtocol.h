@@ -0,0 +1,122 @@
+#ifndef _BOARD_PROTOCOL_H_INCLUDED__
+#define _BOARD_PROTOCOL_H_INCLUDED__
+
+#include <Urho3D/Container/Vector.h>
+#include <Urho3D/Math/Rect.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Deserializer;
+    class Serializer;
+}
+
+class BoardGrid;
+
+/// Server -> client: board size and the next delta sequence, sent once when the client joins. The cells follow in MSG_BOARD_CHUNKS.
+static const int MSG_BOARD_SNAPSHOT = 0xa0;
+/// Server -> client: owners of the cells changed since the previous delta, as the runs of the neighbour cells of one owner.
+static const int MSG_BOARD_DELTA = 0xa1;
+/// Client -> server: touched cells since the previous batch.
+static const int MSG_TOUCH_BATCH = 0xa2;
+/// Server -> client: player slot of the client, the owner of its cells.
+static const int MSG_PLAYER_SLOT = 0xa3;
+/// Server -> client: VLE sequence of the next touch to process and VLE server tick, sent after the deltas with the results.
+static const int MSG_TOUCH_ACK = 0xa4;
+/// Client -> server: VLE left, top, right, bottom of the inclusive rectangle of the chunks the client sees.
+static const int MSG_VIEW_REGION = 0xa5;
+/// Server -> client: owners of all the cells of the chunks, streamed after the join and resent for the stale chunks.
+static const int MSG_BOARD_CHUNKS = 0xa6;
+/// Server -> client: VLE number of the new round, all the cells are free again.
+static const int MSG_BOARD_RESET = 0xa7;
+/// Client -> server: the client failed to decode a delta, the server sends MSG_BOARD_SNAPSHOT and all the chunks again.
+static const int MSG_BOARD_RESYNC = 0xa8;
+
+/// Flag of the owner bit width of MSG_BOARD_CHUNKS, the owners are run-length encoded.
+static const unsigned char OWNER_RUNS_FLAG = 0x80;
+
+/// Key of the room name in the client identity sent on connect, the server routes the connection to the room.
+static const char * const ROOM_IDENTITY = "Room";
+
+/// Touch of a cell on the client.
+struct TouchData
+{
+    /// Touched cell.
+    unsigned cell_;
+    /// Client touch sequence number.
+    unsigned sequence_;
+    /// Client time of the touch in milliseconds.
+    unsigned time_;
+};
+
+/// Return the number of bits enough to store the value, at least one.
+unsigned GetBitsFor(unsigned value);
+/// Return the number of bytes of the value written as VLE.
+unsigned GetVLESize(unsigned value);
+
+/// Writes values of an arbitrary bit width packed into bytes, least significant bit first.
+class BitWriter
+{
+public:
+
+    explicit BitWriter(Serializer & dest);
+    ~BitWriter();
+
+    void Write(unsigned value, unsigned bits);
+    /// Write the pending bits padded to the whole byte.
+    void Flush();
+
+private:
+
+    Serializer & dest_;
+    unsigned long long bits_;
+    unsigned numBits_;
+};
+
+/// Reads values written by BitWriter.
+class BitReader
+{
+public:
+
+    explicit BitReader(Deserializer & source);
+
+    unsigned Read(unsigned bits);
+    /// Return false if the source ran out of data.
+    bool IsValid() const { return valid_; }
+
+private:
+
+    Deserializer & source_;
+    unsigned long long bits_;
+    unsigned numBits_;
+    bool valid_;
+};
+
+/// Write VLE width, VLE height, VLE next delta sequence and VLE round.
+void WriteBoardHeader(Serializer & dest, const BoardGrid & grid, unsigned sequence, unsigned round);
+/// Read the board header, resizing the grid if needed. The cells become free and dirty.
+bool ReadBoardHeader(Deserializer & source, BoardGrid & grid, unsigned & sequence, unsigned & round);
+/// Write VLE count, VLE chunk indices, owner bit width and packed owners of the chunk cells in the chunk order.
+/// If shorter, the owners are run-length encoded instead: the width has OWNER_RUNS_FLAG set and is followed by VLE number
+/// of the runs, VLE length - 1 of every run and packed owners of the runs.
+void WriteBoardChunks(Serializer & dest, const BoardGrid & grid, const PODVector<unsigned> & chunks);
+/// Read the chunks to the grid and append their indices. Only changed cells become dirty.
+bool ReadBoardChunks(Deserializer & source, BoardGrid & grid, PODVector<unsigned> & chunks);
+/// Write VLE sequence, VLE server tick, VLE number of the runs, owner bit width, VLE (gap << 1 | long) of every run
+/// with VLE length - 2 of the long ones and packed owners of the runs. The gap is from the end of the previous run.
+/// The cells are sorted and unique.
+void WriteBoardDelta(Serializer & dest, const BoardGrid & grid, const PODVector<unsigned> & cells, unsigned sequence, unsigned tick);
+/// Apply the delta to the grid.
+bool ReadBoardDelta(Deserializer & source, BoardGrid & grid, unsigned & sequence, unsigned & tick);
+/// Write VLE first sequence, VLE count, base time and VLE (zigzag cell delta, time offset) of the consecutive touches.
+/// The cell delta is from the previous touch, the nearby touches take a byte.
+void WriteTouchBatch(Serializer & dest, const PODVector<TouchData> & touches);
+/// Append the touches of the batch.
+bool ReadTouchBatch(Deserializer & source, PODVector<TouchData> & touches);
+/// Write VLE left, top, right and bottom of the inclusive rectangle of the chunks, none of them negative.
+void WriteViewRegion(Serializer & dest, const IntRect & chunks);
+/// Read the rectangle of the chunks. The rectangle is not clamped to the board.
+bool ReadViewRegion(Deserializer & source, IntRect & chunks);
+
+#endif // _BOARD_PROTOCOL_H_INCLUDED__
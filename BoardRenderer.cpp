@@ -0,0 +1,222 @@
+#include "BoardRenderer.h"
+#include "BoardGrid.h"
+#include "PlayerSlots.h"
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Geometry.h>
+#include <Urho3D/Graphics/IndexBuffer.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/OctreeQuery.h>
+#include <Urho3D/Graphics/VertexBuffer.h>
+#include <Urho3D/Scene/Node.h>
+
+namespace
+{
+    struct CellVertex
+    {
+        Vector3 position_;
+        Vector3 normal_;
+        unsigned color_;
+    };
+
+    const unsigned CELL_VERTICES = 24;
+    const unsigned CELL_INDICES = 36;
+}
+
+BoardRenderer::BoardRenderer(Context * context)
+    : Drawable(context, DRAWABLE_GEOMETRY)
+    , geometry_(MakeShared<Geometry>(context))
+    , vertexBuffer_(MakeShared<VertexBuffer>(context))
+    , indexBuffer_(MakeShared<IndexBuffer>(context))
+{
+    // Keep the CPU copy to update the colors of the cell ranges and to restore the buffers after the device loss
+    vertexBuffer_->SetShadowed(true);
+    indexBuffer_->SetShadowed(true);
+    geometry_->SetVertexBuffer(0, vertexBuffer_);
+    geometry_->SetIndexBuffer(indexBuffer_);
+
+    batches_.Resize(1);
+    batches_[0].geometry_ = geometry_;
+    batches_[0].geometryType_ = GEOM_STATIC;
+}
+
+BoardRenderer::~BoardRenderer()
+{}
+
+void BoardRenderer::RegisterObject(Context * context)
+{
+    context->RegisterFactory<BoardRenderer>();
+}
+
+void BoardRenderer::ProcessRayQuery(const RayOctreeQuery & query, PODVector<RayQueryResult> & results)
+{
+    if(!grid_ || query.ray_.HitDistance(GetWorldBoundingBox()) >= query.maxDistance_)
+        return;
+
+    const auto & transform = node_->GetWorldTransform();
+    auto localRay = query.ray_.Transformed(transform.Inverse());
+
+    auto nearest = M_INFINITY;
+    auto hitCell = M_MAX_UNSIGNED;
+    if(!grid_->Raycast(localRay, hitCell, nearest))
+    {
+        // Ray is almost parallel to the board, test all the cells
+        for(unsigned cell = 0; cell < grid_->GetNumCells(); ++cell)
+        {
+            auto distance = localRay.HitDistance(grid_->GetCellBox(cell));
+            if(distance < nearest)
+            {
+                nearest = distance;
+                hitCell = cell;
+            }
+        }
+    }
+
+    if(hitCell == M_MAX_UNSIGNED)
+        return;
+
+    RayQueryResult result;
+    result.position_ = transform * (localRay.origin_ + localRay.direction_ * nearest);
+    result.normal_ = Vector3::UP;
+    result.distance_ = (result.position_ - query.ray_.origin_).Length();
+    result.drawable_ = this;
+    result.node_ = node_;
+    result.subObject_ = hitCell;
+
+    if(result.distance_ < query.maxDistance_)
+        results.Push(result);
+}
+
+void BoardRenderer::UpdateGeometry(const FrameInfo & frame)
+{
+    if(dirtyCells_.Empty())
+        return;
+
+    // A scattered pair of cells must not upload the whole board between them, the cells of a row run together
+    Sort(dirtyCells_.Begin(), dirtyCells_.End());
+    for(unsigned first = 0; first < dirtyCells_.Size();)
+    {
+        auto begin = dirtyCells_[first];
+        auto end = begin + 1;
+        for(++first; first < dirtyCells_.Size() && dirtyCells_[first] == end; ++first)
+            ++end;
+
+        if(auto vertices = static_cast<CellVertex *>(vertexBuffer_->Lock(begin * CELL_VERTICES, (end - begin) * CELL_VERTICES)))
+        {
+            for(auto cell = begin; cell < end; ++cell)
+            {
+                for(unsigned i = 0; i < CELL_VERTICES; ++i)
+                    (vertices++)->color_ = colors_[cell];
+            }
+            vertexBuffer_->Unlock();
+        }
+    }
+
+    for(auto cell : dirtyCells_)
+        cellDirty_[cell] = false;
+    dirtyCells_.Clear();
+}
+
+UpdateGeometryType BoardRenderer::GetUpdateGeometryType()
+{
+    return dirtyCells_.Empty() ? UPDATE_NONE : UPDATE_MAIN_THREAD;
+}
+
+void BoardRenderer::SetMaterial(Material * material)
+{
+    batches_[0].material_ = material;
+}
+
+void BoardRenderer::SetGrid(BoardGrid * grid)
+{
+    grid_ = grid;
+
+    auto numCells = grid ? grid->GetNumCells() : 0;
+    colors_.Resize(numCells);
+    cellDirty_.Resize(numCells);
+    for(unsigned cell = 0; cell < numCells; ++cell)
+    {
+        colors_[cell] = GetSlotColor(grid->GetOwner(cell)).ToUInt();
+        cellDirty_[cell] = false;
+    }
+
+    static const Vector3 normals[] = { Vector3::RIGHT, Vector3::LEFT, Vector3::UP, Vector3::DOWN, Vector3::FORWARD, Vector3::BACK };
+    static const Vector3 tangents[] = { Vector3::FORWARD, Vector3::FORWARD, Vector3::RIGHT, Vector3::RIGHT, Vector3::RIGHT, Vector3::RIGHT };
+
+    auto numVertices = numCells * CELL_VERTICES;
+    auto largeIndices = numVertices > 0xffff;
+    vertexBuffer_->SetSize(numVertices, MASK_POSITION | MASK_NORMAL | MASK_COLOR);
+    indexBuffer_->SetSize(numCells * CELL_INDICES, largeIndices);
+
+    boundingBox_.Clear();
+    if(numCells)
+    {
+        auto vertices = static_cast<CellVertex *>(vertexBuffer_->Lock(0, numVertices, true));
+        auto indices = indexBuffer_->Lock(0, numCells * CELL_INDICES, true);
+        auto indices16 = static_cast<unsigned short *>(indices);
+        auto indices32 = static_cast<unsigned *>(indices);
+
+        unsigned vertex = 0;
+        for(unsigned cell = 0; cell < numCells; ++cell)
+        {
+            auto box = grid->GetCellBox(cell);
+            auto center = box.Center();
+            auto halfSize = box.HalfSize();
+            boundingBox_.Merge(box);
+
+            for(unsigned face = 0; face < 6; ++face)
+            {
+                // Corners go clockwise looking at the face from outside
+                const auto & n = normals[face];
+                const auto & u = tangents[face];
+                auto v = u.CrossProduct(n);
+                const Vector3 corners[] = { v - u, u + v, u - v, -u - v };
+
+                for(unsigned i = 0; i < 4; ++i)
+                {
+                    vertices->position_ = center + (n + corners[i]) * halfSize;
+                    vertices->normal_ = n;
+                    vertices->color_ = colors_[cell];
+                    ++vertices;
+                }
+
+                const unsigned faceIndices[] = { vertex, vertex + 1, vertex + 2, vertex, vertex + 2, vertex + 3 };
+                for(auto index : faceIndices)
+                {
+                    if(largeIndices)
+                        *indices32++ = index;
+                    else
+                        *indices16++ = static_cast<unsigned short>(index);
+                }
+                vertex += 4;
+            }
+        }
+
+        vertexBuffer_->Unlock();
+        indexBuffer_->Unlock();
+    }
+
+    geometry_->SetDrawRange(TRIANGLE_LIST, 0, numCells * CELL_INDICES);
+    dirtyCells_.Clear();
+    if(node_)
+        OnMarkedDirty(node_);
+}
+
+void BoardRenderer::SetCellColor(unsigned cell, const Color & color)
+{
+    if(cell >= colors_.Size())
+        return;
+
+    colors_[cell] = color.ToUInt();
+    if(!cellDirty_[cell])
+    {
+        cellDirty_[cell] = true;
+        dirtyCells_.Push(cell);
+    }
+}
+
+void BoardRenderer::OnWorldBoundingBoxUpdate()
+{
+    worldBoundingBox_ = boundingBox_.Transformed(node_->GetWorldTransform());
+}
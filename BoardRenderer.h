@@ -0,0 +1,60 @@
+#ifndef _BOARD_RENDERER_H_INCLUDED__
+#define _BOARD_RENDERER_H_INCLUDED__
+
+#include <Urho3D/Graphics/Drawable.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class Geometry;
+    class IndexBuffer;
+    class Material;
+    class VertexBuffer;
+}
+
+class BoardGrid;
+
+/// Draws all the cells of the board as one merged geometry in one batch, not instanced: the stock instancing carries
+/// only the world transform. The cell color is a vertex color, only the vertices of the changed cells are uploaded,
+/// one buffer update per run of the adjacent changed cells.
+class BoardRenderer : public Drawable
+{
+    URHO3D_OBJECT(BoardRenderer, Drawable);
+
+public:
+
+    explicit BoardRenderer(Context * context);
+    virtual ~BoardRenderer();
+    static void RegisterObject(Context * context);
+
+    /// Process octree raycast. The sub object of the result is the cell index.
+    virtual void ProcessRayQuery(const RayOctreeQuery & query, PODVector<RayQueryResult> & results);
+    virtual void UpdateGeometry(const FrameInfo & frame);
+    virtual UpdateGeometryType GetUpdateGeometryType();
+
+    void SetMaterial(Material * material);
+    /// Build the geometry for the grid cells, colored by the current owners.
+    void SetGrid(BoardGrid * grid);
+    /// Set the cell color, uploaded on the next geometry update.
+    void SetCellColor(unsigned cell, const Color & color);
+
+protected:
+
+    virtual void OnWorldBoundingBoxUpdate();
+
+private:
+
+    WeakPtr<BoardGrid> grid_;
+    SharedPtr<Geometry> geometry_;
+    SharedPtr<VertexBuffer> vertexBuffer_;
+    SharedPtr<IndexBuffer> indexBuffer_;
+    /// Color of each cell.
+    PODVector<unsigned> colors_;
+    /// Cells changed since the last geometry update, each once.
+    PODVector<unsigned> dirtyCells_;
+    PODVector<bool> cellDirty_;
+};
+
+#endif // _BOARD_RENDERER_H_INCLUDED__
@@ -0,0 +1,297 @@
+#include "BoardRooms.h"
+#include "BoardProfiler.h"
+#include "BoardProtocol.h"
+#include "BoardSession.h"
+#include "StringFormat.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Scene/Scene.h>
+
+namespace
+{
+    /// The room name goes to the logs and the metrics as is, so only the plain characters are accepted.
+    bool IsValidRoomName(const String & name)
+    {
+        if(name.Length() > MAX_ROOM_NAME_LENGTH)
+            return false;
+        for(unsigned i = 0; i < name.Length(); ++i)
+        {
+            auto c = name[i];
+            if(!IsAlpha(c) && !IsDigit(c) && c != '-' && c != '_')
+                return false;
+        }
+        return true;
+    }
+}
+
+BoardRooms::BoardRooms(Context * context)
+    : Object(context)
+    , boardSize_(0)
+    , maxPlayers_(0)
+    , maxRooms_(DEFAULT_MAX_ROOMS)
+    , tickRate_(DEFAULT_TICK_RATE)
+    , roundTime_(0.0f)
+    , tickAcc_(0.0f)
+{}
+
+BoardRooms::~BoardRooms()
+{
+    Stop();
+}
+
+void BoardRooms::SetTickRate(unsigned tickRate)
+{
+    tickRate_ = Max(tickRate, 1u);
+    for(auto & room : rooms_)
+        room.session_->SetTickRate(tickRate_);
+}
+
+void BoardRooms::Start(Scene * scene, int size, unsigned maxPlayers, const String & snapshotFile)
+{
+    Stop();
+
+    boardSize_ = size;
+    maxPlayers_ = maxPlayers;
+    tickAcc_ = 0.0f;
+
+    auto room = CreateRoom(String::EMPTY, scene);
+    room->session_->Start(scene, size, maxPlayers, snapshotFile);
+
+    SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(BoardRooms, HandleUpdate));
+    metricsTimer_.Reset();
+}
+
+void BoardRooms::Stop()
+{
+    UnsubscribeFromAllEvents();
+    rooms_.Clear();
+    connections_.Clear();
+}
+
+bool BoardRooms::StartJournal(const String & fileName)
+{
+    auto session = GetSession(String::EMPTY);
+    return session && session->StartJournal(fileName);
+}
+
+bool BoardRooms::AddConnection(Connection * connection)
+{
+    if(rooms_.Empty())
+        return false;
+
+    String name;
+    auto & identity = connection->GetIdentity();
+    auto it = identity.Find(ROOM_IDENTITY);
+    if(it != identity.End())
+        name = it->second_.GetString();
+    if(!IsValidRoomName(name))
+    {
+        URHO3D_LOGWARNINGF("Invalid room name from %s", connection->ToString().CString());
+        return false;
+    }
+
+    auto room = FindRoom(name);
+    if(!room)
+    {
+        if(rooms_.Size() >= maxRooms_)
+        {
+            URHO3D_LOGWARNINGF("No room left for %s, %u rooms are open", name.CString(), rooms_.Size());
+            return false;
+        }
+
+        // The room scene holds only the board components, the clients build their own scene content
+        auto scene = MakeShared<Scene>(context_);
+        room = CreateRoom(name, scene);
+        room->session_->Start(scene, boardSize_, maxPlayers_);
+        URHO3D_LOGINFOF("Room %s opened, %u rooms", name.CString(), rooms_.Size());
+    }
+
+    if(!room->session_->AddConnection(connection))
+    {
+        // The empty room just created for the connection is not kept
+        if(!room->numConnections_ && !name.Empty())
+            rooms_.Erase(rooms_.Size() - 1);
+        return false;
+    }
+
+    ++room->numConnections_;
+    connections_[connection] = name;
+    return true;
+}
+
+void BoardRooms::RemoveConnection(Connection * connection)
+{
+    auto it = connections_.Find(connection);
+    if(it == connections_.End())
+        return;
+
+    auto name = it->second_;
+    connections_.Erase(it);
+
+    for(unsigned i = 0; i < rooms_.Size(); ++i)
+    {
+        auto & room = rooms_[i];
+        if(room.name_ != name)
+            continue;
+
+        room.session_->RemoveConnection(connection);
+        if(!--room.numConnections_ && !name.Empty())
+        {
+            rooms_.Erase(i);
+            URHO3D_LOGINFOF("Room %s closed, %u rooms", name.CString(), rooms_.Size());
+        }
+        break;
+    }
+}
+
+BoardSession * BoardRooms::GetSession(const String & name) const
+{
+    for(auto & room : rooms_)
+    {
+        if(room.name_ == name)
+            return room.session_;
+    }
+    return nullptr;
+}
+
+BoardRooms::Room * BoardRooms::CreateRoom(const String & name, Scene * scene)
+{
+    Room room;
+    room.name_ = name;
+    room.scene_ = scene;
+    room.session_ = MakeShared<BoardSession>(context_);
+    room.session_->SetAutoTick(false);
+    room.session_->SetTickRate(tickRate_);
+    room.session_->SetRoundTime(roundTime_);
+    room.numConnections_ = 0;
+    room.ticks_ = 0;
+    room.tickTime_ = room.tickTotal_ = room.tickMax_ = 0;
+    room.inPass_ = false;
+    rooms_.Push(room);
+    return &rooms_.Back();
+}
+
+BoardRooms::Room * BoardRooms::FindRoom(const String & name)
+{
+    for(auto & room : rooms_)
+    {
+        if(room.name_ == name)
+            return &room;
+    }
+    return nullptr;
+}
+
+void BoardRooms::HandleUpdate(StringHash eventType, VariantMap & eventData)
+{
+    using namespace Update;
+
+    auto tickStep = 1.0f / tickRate_;
+    tickAcc_ += eventData[P_TIMESTEP].GetFloat();
+
+    unsigned numTicks = 0;
+    for(; tickAcc_ >= tickStep && numTicks < MAX_TICKS_PER_FRAME; ++numTicks)
+    {
+        tickAcc_ -= tickStep;
+        RunTick(tickStep);
+    }
+
+    // Too slow to catch up, drop the lag instead of spiraling
+    if(numTicks == MAX_TICKS_PER_FRAME)
+        tickAcc_ = Min(tickAcc_, tickStep);
+
+    if(metricsTimer_.GetMSec(false) >= METRICS_INTERVAL * 1000.0f)
+    {
+        WriteMetrics();
+        metricsTimer_.Reset();
+    }
+}
+
+void BoardRooms::RunTick(float timeStep)
+{
+    auto profiler = GetSubsystem<BoardProfiler>();
+    if(profiler)
+        profiler->BeginTick();
+
+    for(auto & room : rooms_)
+    {
+        tickTimer_.Reset();
+        room.session_->BeginTick();
+        room.session_->BeginClaims();
+        room.tickTime_ = tickTimer_.GetUSec(false);
+    }
+
+    // The passes of all the rooms are in the queue together, the commit passes start after all the race passes
+    {
+        ProfileBlock block(profiler, PROFILE_CLAIMS);
+        auto queue = GetSubsystem<WorkQueue>();
+        for(;;)
+        {
+            unsigned numPasses = 0;
+            for(auto & room : rooms_)
+            {
+                room.inPass_ = room.session_->BeginClaimPass(queue);
+                if(room.inPass_)
+                    ++numPasses;
+            }
+            if(!numPasses)
+                break;
+
+            queue->Complete(M_MAX_UNSIGNED);
+            for(auto & room : rooms_)
+            {
+                if(!room.inPass_)
+                    continue;
+                tickTimer_.Reset();
+                room.session_->EndClaimPass();
+                room.tickTime_ += tickTimer_.GetUSec(false);
+            }
+        }
+    }
+
+    for(auto & room : rooms_)
+    {
+        tickTimer_.Reset();
+        room.session_->EndClaims();
+        room.session_->EndTick(timeStep);
+        room.tickTime_ += tickTimer_.GetUSec(false);
+
+        ++room.ticks_;
+        room.tickTotal_ += room.tickTime_;
+        room.tickMax_ = Max(room.tickMax_, room.tickTime_);
+    }
+
+    if(profiler)
+        profiler->EndTick(timeStep);
+}
+
+void BoardRooms::WriteMetrics()
+{
+    if(auto profiler = GetSubsystem<BoardProfiler>())
+    {
+        String line("{\"rooms\":[");
+        for(unsigned i = 0; i < rooms_.Size(); ++i)
+        {
+            auto & room = rooms_[i];
+            auto ticks = Max(room.ticks_, 1u);
+            auto & scores = room.session_->GetScores();
+            auto leader = scores.GetLeader();
+            line += FormatString("%s{\"name\":\"%s\",\"connections\":%u,\"round\":%u,\"ticks\":%u,"
+                "\"tick_ms\":{\"avg\":%.3f,\"max\":%.3f},\"claims\":%u,\"leader\":%u,\"leader_cells\":%u,\"memory_kb\":%.1f}",
+                i ? "," : "", room.name_.CString(), room.numConnections_, room.session_->GetRound(), room.ticks_,
+                room.tickTotal_ / ticks / 1000.0f, room.tickMax_ / 1000.0f, room.session_->GetNumClaims(), leader,
+                scores.GetCells(leader), room.session_->GetMemoryUse() / 1024.0f);
+        }
+        line += "]}";
+        profiler->WriteMetricsLine(line);
+    }
+
+    for(auto & room : rooms_)
+    {
+        room.ticks_ = 0;
+        room.tickTotal_ = room.tickMax_ = 0;
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef _BOARD_ROOMS_H_INCLUDED__
+#define _BOARD_ROOMS_H_INCLUDED__
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Container/HashMap.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Connection;
+    class Context;
+    class Scene;
+}
+
+class BoardSession;
+
+/// Default maximum number of the rooms of one server process.
+static const unsigned DEFAULT_MAX_ROOMS = 16;
+/// Maximum length of the room name.
+static const unsigned MAX_ROOM_NAME_LENGTH = 32;
+
+/// Hosts the independent board rooms of the server process. Every room is a BoardSession with its own scene,
+/// board and player slots; the engine, the network port, the resource cache and the worker threads are shared.
+/// A connection joins the room named in its identity (ROOM_IDENTITY) on the handshake. The default room has the empty name
+/// and lives as long as the manager, the other rooms are created on the first join and removed when the last player leaves.
+/// The rooms tick together: the touches and the replication run room by room on the main thread, the claim passes
+/// of all the rooms go to the work queue at once, so the small rooms share the worker threads.
+class BoardRooms : public Object
+{
+    URHO3D_OBJECT(BoardRooms, Object);
+
+public:
+
+    explicit BoardRooms(Context * context);
+    virtual ~BoardRooms();
+
+    /// Set the number of the ticks per second of all the rooms.
+    void SetTickRate(unsigned tickRate);
+    /// Set the round length of the rooms created from now on.
+    void SetRoundTime(float seconds) { roundTime_ = seconds; }
+    /// Set the maximum number of the rooms including the default one.
+    void SetMaxRooms(unsigned maxRooms) { maxRooms_ = Max(maxRooms, 1u); }
+
+    /// Create the default room in the scene. The rooms get the boards of the size x size cells for up to maxPlayers players,
+    /// the snapshot file is kept for the default room only.
+    void Start(Scene * scene, int size, unsigned maxPlayers, const String & snapshotFile = String::EMPTY);
+    /// Remove all the rooms.
+    void Stop();
+    /// Record the touches of the default room to the journal.
+    bool StartJournal(const String & fileName);
+
+    /// Route the connection to the room of its identity, creating the room if needed. Return false if the room name is invalid,
+    /// there is no room left or the room is full.
+    bool AddConnection(Connection * connection);
+    /// Release the slot of the connection and remove its room if it is empty.
+    void RemoveConnection(Connection * connection);
+
+    /// Return the session of the room or null.
+    BoardSession * GetSession(const String & name) const;
+    unsigned GetNumRooms() const { return rooms_.Size(); }
+
+private:
+
+    struct Room
+    {
+        String name_;
+        SharedPtr<Scene> scene_;
+        SharedPtr<BoardSession> session_;
+        unsigned numConnections_;
+        /// Main thread time of the ticks in the metrics interval, the shared claim passes are not attributed to the rooms.
+        unsigned ticks_;
+        long long tickTime_;
+        long long tickTotal_;
+        long long tickMax_;
+        /// The claim pass of the room is in the work queue.
+        bool inPass_;
+    };
+
+    Room * CreateRoom(const String & name, Scene * scene);
+    Room * FindRoom(const String & name);
+    void HandleUpdate(StringHash eventType, VariantMap & eventData);
+    void RunTick(float timeStep);
+    /// Write the room statistics to the profiler metrics output.
+    void WriteMetrics();
+
+private:
+
+    Vector<Room> rooms_;
+    /// Room name of every connection.
+    HashMap<Connection*, String> connections_;
+    int boardSize_;
+    unsigned maxPlayers_;
+    unsigned maxRooms_;
+    unsigned tickRate_;
+    float roundTime_;
+    /// Frame time not consumed by the ticks.
+    float tickAcc_;
+    HiresTimer tickTimer_;
+    Timer metricsTimer_;
+};
+
+#endif // _BOARD_ROOMS_H_INCLUDED__
@@ -0,0 +1,242 @@
+#include "BoardScores.h"
+#include "BoardGrid.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+    unsigned PopCount(unsigned long long value)
+    {
+#ifdef _MSC_VER
+        return static_cast<unsigned>(__popcnt64(value));
+#else
+        return static_cast<unsigned>(__builtin_popcountll(value));
+#endif
+    }
+
+    /// Grow the region by one step inside the mask, over the rows first..last. 64 cells are processed at once:
+    /// the horizontal neighbours are the shifts with the carries between the words of a row, the vertical ones
+    /// are the words one row apart. Return true if the region grew.
+    bool DilateRegion(const unsigned long long * mask, const unsigned long long * region, unsigned long long * next,
+        unsigned rowWords, unsigned height, unsigned first, unsigned last)
+    {
+        auto changed = false;
+        for(auto row = first; row <= last; ++row)
+        {
+            for(unsigned x = 0; x < rowWords; ++x)
+            {
+                auto i = row * rowWords + x;
+                auto value = region[i];
+                auto grown = value | value << 1 | value >> 1;
+                if(x > 0)
+                    grown |= region[i - 1] >> 63;
+                if(x + 1 < rowWords)
+                    grown |= region[i + 1] << 63;
+                if(row > 0)
+                    grown |= region[i - rowWords];
+                if(row + 1 < height)
+                    grown |= region[i + rowWords];
+
+                next[i] = grown & mask[i];
+                changed |= next[i] != value;
+            }
+        }
+        return changed;
+    }
+}
+
+BoardScores::BoardScores()
+    : width_(0)
+    , height_(0)
+    , rowWords_(0)
+{
+    Reset(0, 0);
+}
+
+void BoardScores::Reset(int width, int height)
+{
+    width_ = static_cast<unsigned>(Max(width, 0));
+    height_ = static_cast<unsigned>(Max(height, 0));
+    rowWords_ = (width_ + 63) / 64;
+
+    boards_.Clear();
+    boards_.Resize(MAX_PLAYERS + 1);
+    parents_.Resize(width_ * height_);
+    sizes_.Resize(width_ * height_);
+    for(unsigned slot = 0; slot <= MAX_PLAYERS; ++slot)
+        cells_[slot] = regions_[slot] = largest_[slot] = 0;
+}
+
+void BoardScores::Claim(unsigned cell, unsigned char owner)
+{
+    if(cell >= parents_.Size() || owner == NO_OWNER)
+        return;
+
+    auto & board = boards_[owner];
+    if(board.Empty())
+    {
+        board.Resize(rowWords_ * height_);
+        for(auto & word : board)
+            word = 0;
+    }
+    board[GetWord(cell)] |= GetBit(cell);
+
+    ++cells_[owner];
+    ++regions_[owner];
+    parents_[cell] = cell;
+    sizes_[cell] = 1;
+
+    // Every neighbour region of the owner merges with the new cell
+    auto root = cell;
+    auto x = cell % width_;
+    unsigned neighbours[4];
+    unsigned numNeighbours = 0;
+    if(x > 0)
+        neighbours[numNeighbours++] = cell - 1;
+    if(x + 1 < width_)
+        neighbours[numNeighbours++] = cell + 1;
+    if(cell >= width_)
+        neighbours[numNeighbours++] = cell - width_;
+    if(cell + width_ < parents_.Size())
+        neighbours[numNeighbours++] = cell + width_;
+
+    for(unsigned i = 0; i < numNeighbours; ++i)
+    {
+        if(!IsOwner(neighbours[i], owner))
+            continue;
+
+        auto other = FindRoot(neighbours[i]);
+        if(other == root)
+            continue;
+
+        // Union by size keeps the trees flat
+        if(sizes_[other] > sizes_[root])
+            Swap(other, root);
+        parents_[other] = root;
+        sizes_[root] += sizes_[other];
+        --regions_[owner];
+    }
+
+    largest_[owner] = Max(largest_[owner], sizes_[root]);
+}
+
+void BoardScores::ResetCells(const BoardGrid & grid, const PODVector<unsigned> & cells)
+{
+    for(auto cell : cells)
+    {
+        auto owner = grid.GetOwner(cell);
+        if(cell < parents_.Size() && !boards_[owner].Empty())
+            boards_[owner][GetWord(cell)] &= ~GetBit(cell);
+    }
+
+    // The union-find entries of the free cells are not read, they are set again on the claim
+    for(unsigned slot = 0; slot <= MAX_PLAYERS; ++slot)
+        cells_[slot] = regions_[slot] = largest_[slot] = 0;
+}
+
+unsigned char BoardScores::GetLeader() const
+{
+    unsigned char leader = NO_OWNER;
+    for(unsigned slot = 1; slot <= MAX_PLAYERS; ++slot)
+    {
+        if(cells_[slot] > cells_[leader])
+            leader = static_cast<unsigned char>(slot);
+    }
+    return leader;
+}
+
+bool BoardScores::IsOwner(unsigned cell, unsigned char owner) const
+{
+    auto & board = boards_[owner];
+    return cell < parents_.Size() && !board.Empty() && (board[GetWord(cell)] & GetBit(cell));
+}
+
+void BoardScores::Recount(unsigned char owner, unsigned & cells, unsigned & regions, unsigned & largest) const
+{
+    cells = regions = largest = 0;
+
+    auto & board = boards_[owner];
+    if(board.Empty())
+        return;
+
+    for(auto word : board)
+        cells += PopCount(word);
+
+    // Fill the region of the first remaining cell and take it out, the fill covers only the rows the region may reach
+    PODVector<unsigned long long> rest(board);
+    PODVector<unsigned long long> region(board.Size());
+    PODVector<unsigned long long> next(board.Size());
+    for(auto & word : region)
+        word = 0;
+    for(auto & word : next)
+        word = 0;
+
+    unsigned start = 0;
+    while(true)
+    {
+        while(start < rest.Size() && !rest[start])
+            ++start;
+        if(start == rest.Size())
+            break;
+
+        auto first = start / rowWords_;
+        auto last = first;
+        region[start] = rest[start] & (~rest[start] + 1);
+        while(true)
+        {
+            auto top = first ? first - 1 : first;
+            auto bottom = Min(last + 1, height_ - 1);
+            if(!DilateRegion(&rest[0], &region[0], &next[0], rowWords_, height_, top, bottom))
+                break;
+            for(auto row = top; row <= bottom; ++row)
+            {
+                for(unsigned x = 0; x < rowWords_; ++x)
+                    region[row * rowWords_ + x] = next[row * rowWords_ + x];
+            }
+
+            // The region reached a new row if the row was empty before
+            for(unsigned x = 0; x < rowWords_; ++x)
+            {
+                if(region[top * rowWords_ + x])
+                    first = top;
+                if(region[bottom * rowWords_ + x])
+                    last = bottom;
+            }
+        }
+
+        unsigned size = 0;
+        for(auto row = first; row <= last; ++row)
+        {
+            for(unsigned x = 0; x < rowWords_; ++x)
+            {
+                auto i = row * rowWords_ + x;
+                size += PopCount(region[i]);
+                rest[i] &= ~region[i];
+                region[i] = 0;
+            }
+        }
+
+        ++regions;
+        largest = Max(largest, size);
+    }
+}
+
+unsigned BoardScores::GetMemoryUse() const
+{
+    unsigned bytes = (parents_.Capacity() + sizes_.Capacity()) * sizeof(unsigned);
+    for(auto & board : boards_)
+        bytes += board.Capacity() * sizeof(unsigned long long);
+    return bytes;
+}
+
+unsigned BoardScores::FindRoot(unsigned cell)
+{
+    while(parents_[cell] != cell)
+    {
+        parents_[cell] = parents_[parents_[cell]];
+        cell = parents_[cell];
+    }
+    return cell;
+}
@@ -0,0 +1,70 @@
+#ifndef _BOARD_SCORES_H_INCLUDED__
+#define _BOARD_SCORES_H_INCLUDED__
+
+#include <Urho3D/Container/Vector.h>
+
+#include "PlayerSlots.h"
+
+using namespace Urho3D;
+
+class BoardGrid;
+
+/// Ownership statistics of the board for the leaderboards and the end of round evaluation.
+/// Every player slot has a bitboard of its cells (rows padded to 64 bit words), the cell counts and the connected
+/// regions (4-neighbourhood) are kept up to date on every claim. A cell is only claimed while free and the round
+/// frees all the cells at once, so the regions are an add-only union-find and the new round resets only the claimed cells.
+class BoardScores
+{
+public:
+
+    BoardScores();
+
+    /// Size the statistics for the board and clear them.
+    void Reset(int width, int height);
+    /// Account the claim of the free cell by the owner.
+    void Claim(unsigned cell, unsigned char owner);
+    /// Release all the cells claimed in the round, before the grid frees them.
+    void ResetCells(const BoardGrid & grid, const PODVector<unsigned> & cells);
+
+    /// Return the number of the cells of the owner.
+    unsigned GetCells(unsigned char owner) const { return cells_[owner]; }
+    /// Return the number of the connected regions of the owner.
+    unsigned GetRegions(unsigned char owner) const { return regions_[owner]; }
+    /// Return the number of the cells in the largest region of the owner.
+    unsigned GetLargestRegion(unsigned char owner) const { return largest_[owner]; }
+    /// Return the owner of the most cells or NO_OWNER on the empty board.
+    unsigned char GetLeader() const;
+    /// Return true if the cell is set in the bitboard of the owner.
+    bool IsOwner(unsigned cell, unsigned char owner) const;
+
+    /// Recount the cells and the regions of the owner from its bitboard with the word parallel popcount and flood fill,
+    /// independent of the incremental counts.
+    void Recount(unsigned char owner, unsigned & cells, unsigned & regions, unsigned & largest) const;
+    /// Return the bytes held by the bitboards and the union-find.
+    unsigned GetMemoryUse() const;
+
+private:
+
+    unsigned GetWord(unsigned cell) const { return (cell / width_) * rowWords_ + (cell % width_) / 64; }
+    unsigned long long GetBit(unsigned cell) const { return 1ull << (cell % width_ % 64); }
+    /// Return the root of the region of the claimed cell, halving the path.
+    unsigned FindRoot(unsigned cell);
+
+private:
+
+    unsigned width_;
+    unsigned height_;
+    /// Words of one bitboard row.
+    unsigned rowWords_;
+    /// Bitboard of every slot, allocated on its first claim.
+    Vector<PODVector<unsigned long long> > boards_;
+    /// Union-find parent of every claimed cell.
+    PODVector<unsigned> parents_;
+    /// Region size, valid at the roots.
+    PODVector<unsigned> sizes_;
+    unsigned cells_[MAX_PLAYERS + 1];
+    unsigned regions_[MAX_PLAYERS + 1];
+    unsigned largest_[MAX_PLAYERS + 1];
+};
+
+#endif // _BOARD_SCORES_H_INCLUDED__
@@ -0,0 +1,279 @@
+#include "BoardServer.h"
+#include "BoardGrid.h"
+#include "BoardProfiler.h"
+#include "BoardProtocol.h"
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Scene/Scene.h>
+
+BoardServer::BoardServer(Context * context)
+    : Component(context)
+    , staleTime_(0.0f)
+    , round_(0)
+{}
+
+void BoardServer::RegisterObject(Context * context)
+{
+    context->RegisterFactory<BoardServer>();
+}
+
+void BoardServer::SendSnapshot(Connection * connection)
+{
+    if(auto grid = scene_ ? scene_->GetComponent<BoardGrid>() : nullptr)
+    {
+        auto profiler = GetSubsystem<BoardProfiler>();
+        ProfileBlock block(profiler, PROFILE_REPLICATION);
+
+        // Nothing is sent yet, stream the chunks in the row order until the client tells its view
+        auto & state = connections_[connection];
+        auto numChunks = grid->GetNumChunks();
+        auto count = static_cast<unsigned>(numChunks.x_ * numChunks.y_);
+        state.chunks_.Resize(count);
+        state.unsentChunks_.Resize(count);
+        for(unsigned i = 0; i < count; ++i)
+        {
+            state.chunks_[i] = CHUNK_UNSENT;
+            state.unsentChunks_[i] = count - 1 - i;
+        }
+        state.staleChunks_.Clear();
+        state.hasView_ = false;
+        state.viewChanged_ = false;
+
+        // Reliable and ordered on the same channel as the chunks and deltas, so the client applies them on top of the header
+        message_.Clear();
+        WriteBoardHeader(message_, *grid, state.sequence_, round_);
+        connection->SendMessage(MSG_BOARD_SNAPSHOT, true, true, message_);
+        if(profiler)
+            profiler->AddBytesSent(connection, message_.GetSize());
+    }
+}
+
+void BoardServer::SendReset(unsigned round)
+{
+    round_ = round;
+
+    auto profiler = GetSubsystem<BoardProfiler>();
+    ProfileBlock block(profiler, PROFILE_REPLICATION);
+
+    // Ordered after the deltas of the previous round, the unsent and stale chunks are sent later with the new state
+    message_.Clear();
+    message_.WriteVLE(round_);
+    for(auto it = connections_.Begin(); it != connections_.End(); ++it)
+    {
+        it->first_->SendMessage(MSG_BOARD_RESET, true, true, message_);
+        if(profiler)
+            profiler->AddBytesSent(it->first_, message_.GetSize());
+    }
+}
+
+unsigned BoardServer::GetMemoryUse() const
+{
+    unsigned bytes = dirty_.Capacity() * sizeof(unsigned long long) + (cells_.Capacity() + sendChunks_.Capacity()) * sizeof(unsigned) +
+        message_.GetBuffer().Capacity();
+    for(auto it = connections_.Begin(); it != connections_.End(); ++it)
+    {
+        auto & state = it->second_;
+        bytes += sizeof(ConnectionState) + state.chunks_.Capacity() +
+            (state.staleChunks_.Capacity() + state.unsentChunks_.Capacity()) * sizeof(unsigned);
+    }
+    return bytes;
+}
+
+void BoardServer::OnSceneSet(Scene * scene)
+{
+    if(scene)
+    {
+        scene_ = GetScene();
+        SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(BoardServer, HandleNetworkMessage));
+        SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(BoardServer, HandleClientDisconnected));
+    }
+    else
+    {
+        UnsubscribeFromAllEvents();
+        connections_.Clear();
+    }
+}
+
+void BoardServer::HandleNetworkMessage(StringHash eventType, VariantMap & eventData)
+{
+    using namespace NetworkMessage;
+
+    auto messageId = eventData[P_MESSAGEID].GetInt();
+    if(messageId != MSG_VIEW_REGION && messageId != MSG_BOARD_RESYNC)
+        return;
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    auto it = connections_.Find(connection);
+    auto grid = scene_->GetComponent<BoardGrid>();
+    if(it == connections_.End() || !grid)
+        return;
+
+    // Joins again on the same delta sequence, the deltas in flight are dropped by the client until the header
+    if(messageId == MSG_BOARD_RESYNC)
+    {
+        SendSnapshot(connection);
+        return;
+    }
+
+    // A truncated region keeps the previous view
+    MemoryBuffer message(eventData[P_DATA].GetBuffer());
+    IntRect view;
+    if(!ReadViewRegion(message, view))
+        return;
+
+    auto numChunks = grid->GetNumChunks();
+    view.right_ = Min(view.right_, numChunks.x_ - 1);
+    view.bottom_ = Min(view.bottom_, numChunks.y_ - 1);
+
+    it->second_.view_ = view;
+    it->second_.hasView_ = true;
+    it->second_.viewChanged_ = true;
+}
+
+void BoardServer::HandleClientDisconnected(StringHash eventType, VariantMap & eventData)
+{
+    using namespace ClientDisconnected;
+
+    connections_.Erase(static_cast<Connection*>(eventData[P_CONNECTION].GetPtr()));
+}
+
+void BoardServer::SendDelta(unsigned tick, float timeStep)
+{
+    auto network = GetSubsystem<Network>();
+    if(!network->IsServerRunning())
+        return;
+
+    auto grid = scene_->GetComponent<BoardGrid>();
+    if(!grid)
+        return;
+
+    auto profiler = GetSubsystem<BoardProfiler>();
+    ProfileBlock block(profiler, PROFILE_REPLICATION);
+
+    staleTime_ += timeStep;
+    auto sendStale = staleTime_ >= STALE_CHUNKS_INTERVAL;
+    if(sendStale)
+        staleTime_ = 0.0f;
+
+    // Group the dirty cells by the chunk once for all the connections
+    dirty_.Clear();
+    for(auto cell : grid->GetDirtyCells())
+    {
+        auto chunkIndex = static_cast<unsigned long long>(grid->GetChunkIndex(grid->GetCellChunk(cell)));
+        dirty_.Push(chunkIndex << 32 | cell);
+    }
+    Sort(dirty_.Begin(), dirty_.End());
+    grid->ClearDirty();
+
+    for(auto it = connections_.Begin(); it != connections_.End(); ++it)
+    {
+        auto connection = it->first_;
+        auto & state = it->second_;
+        cells_.Clear();
+        sendChunks_.Clear();
+
+        // The unsent and stale chunks are sent as a whole later, with the changes
+        for(auto key : dirty_)
+        {
+            auto chunkIndex = static_cast<unsigned>(key >> 32);
+            if(state.chunks_[chunkIndex] != CHUNK_SENT)
+                continue;
+
+            if(state.IsInView(grid->GetChunkCoords(chunkIndex)))
+                cells_.Push(static_cast<unsigned>(key));
+            else
+            {
+                state.chunks_[chunkIndex] = CHUNK_STALE;
+                state.staleChunks_.Push(chunkIndex);
+            }
+        }
+
+        // Resend the whole stale chunks which came into the view, or all of them from time to time
+        if(state.staleChunks_.Size() && (sendStale || state.viewChanged_))
+        {
+            for(unsigned i = 0; i < state.staleChunks_.Size();)
+            {
+                auto chunkIndex = state.staleChunks_[i];
+                if(sendStale || state.IsInView(grid->GetChunkCoords(chunkIndex)))
+                {
+                    sendChunks_.Push(chunkIndex);
+                    state.chunks_[chunkIndex] = CHUNK_SENT;
+                    state.staleChunks_.EraseSwap(i);
+                }
+                else
+                    ++i;
+            }
+        }
+
+        // Stream the join: the view first, then the nearest chunks within the byte limit
+        if(state.unsentChunks_.Size())
+        {
+            if(state.viewChanged_)
+                PrioritizeUnsent(grid, state);
+
+            unsigned bytes = 0;
+            while(state.unsentChunks_.Size() && bytes < JOIN_BYTES_PER_UPDATE)
+            {
+                auto chunkIndex = state.unsentChunks_.Back();
+                state.unsentChunks_.Pop();
+                sendChunks_.Push(chunkIndex);
+                state.chunks_[chunkIndex] = CHUNK_SENT;
+
+                // Upper bound of the chunk with one byte owners
+                bytes += CHUNK_SIZE * CHUNK_SIZE;
+            }
+        }
+        state.viewChanged_ = false;
+
+        if(sendChunks_.Size())
+        {
+            message_.Clear();
+            WriteBoardChunks(message_, *grid, sendChunks_);
+            connection->SendMessage(MSG_BOARD_CHUNKS, true, true, message_);
+            if(profiler)
+                profiler->AddBytesSent(connection, message_.GetSize());
+        }
+
+        if(cells_.Empty())
+            continue;
+
+        // The deltas are reliable, so the transport acknowledges them and a delta never has to be resent.
+        // The delta encodes the gaps between the sorted cells, the dirty list is in the chunk order
+        Sort(cells_.Begin(), cells_.End());
+        message_.Clear();
+        WriteBoardDelta(message_, *grid, cells_, state.sequence_++, tick);
+        connection->SendMessage(MSG_BOARD_DELTA, true, true, message_);
+        if(profiler)
+            profiler->AddBytesSent(connection, message_.GetSize());
+    }
+}
+
+void BoardServer::PrioritizeUnsent(BoardGrid * grid, ConnectionState & state)
+{
+    for(unsigned i = 0; i < state.unsentChunks_.Size();)
+    {
+        auto chunkIndex = state.unsentChunks_[i];
+        if(state.IsInView(grid->GetChunkCoords(chunkIndex)))
+        {
+            sendChunks_.Push(chunkIndex);
+            state.chunks_[chunkIndex] = CHUNK_SENT;
+            state.unsentChunks_.EraseSwap(i);
+        }
+        else
+            ++i;
+    }
+
+    // The farthest first, the next chunk is taken from the back
+    IntVector2 center((state.view_.left_ + state.view_.right_) / 2, (state.view_.top_ + state.view_.bottom_) / 2);
+    Sort(state.unsentChunks_.Begin(), state.unsentChunks_.End(), [grid, center](unsigned lhs, unsigned rhs)
+    {
+        auto a = grid->GetChunkCoords(lhs) - center;
+        auto b = grid->GetChunkCoords(rhs) - center;
+        return a.x_ * a.x_ + a.y_ * a.y_ > b.x_ * b.x_ + b.y_ * b.y_;
+    });
+}
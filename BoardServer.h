@@ -0,0 +1,113 @@
+#ifndef _BOARD_SERVER_H_INCLUDED__
+#define _BOARD_SERVER_H_INCLUDED__
+
+#include <Urho3D/Scene/Component.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Connection;
+    class Context;
+    class Scene;
+}
+
+class BoardGrid;
+
+/// Interval of the updates of the changed chunks outside of the client view, in seconds.
+static const float STALE_CHUNKS_INTERVAL = 1.0f;
+/// Limit of the chunk bytes streamed to a joining client per network update, the chunks in the view are not limited.
+static const unsigned JOIN_BYTES_PER_UPDATE = 4096;
+
+/// Sends the BoardGrid state to the clients: the board header on join, then the chunks, and the dirty cells on every network update.
+/// The chunks of a joining client are streamed: the ones in its view at once, the rest nearest first within JOIN_BYTES_PER_UPDATE.
+/// Changes inside the chunks a client sees are sent at once, the changed chunks outside are resent as a whole
+/// at the low rate or when they come into the view.
+class BoardServer : public Component
+{
+    URHO3D_OBJECT(BoardServer, Component);
+
+public:
+
+    explicit BoardServer(Context * context);
+    static void RegisterObject(Context * context);
+
+    /// Send the board header to the newly connected client and start streaming the chunks.
+    void SendSnapshot(Connection * connection);
+    /// Send the chunks and the dirty cells of the tick to every client.
+    void SendDelta(unsigned tick, float timeStep);
+    /// Tell every client that the round starts and all the cells are free.
+    void SendReset(unsigned round);
+    /// Return the bytes held by the chunk states of the connections and the send buffers.
+    unsigned GetMemoryUse() const;
+
+protected:
+
+    void OnSceneSet(Scene * scene);
+
+private:
+
+    void HandleNetworkMessage(StringHash eventType, VariantMap & eventData);
+    void HandleClientDisconnected(StringHash eventType, VariantMap & eventData);
+
+private:
+
+    enum ChunkState
+    {
+        /// Not sent since the join.
+        CHUNK_UNSENT = 0,
+        /// Client has the chunk and gets its deltas.
+        CHUNK_SENT,
+        /// Changed outside of the view, to be resent as a whole.
+        CHUNK_STALE
+    };
+
+    struct ConnectionState
+    {
+        ConnectionState()
+            : sequence_(0)
+            , hasView_(false)
+            , viewChanged_(false)
+        {}
+
+        /// Return true if the client sees the chunk. All the chunks are in the view until the client tells it.
+        bool IsInView(const IntVector2 & chunk) const
+        {
+            return !hasView_ || (chunk.x_ >= view_.left_ && chunk.x_ <= view_.right_ && chunk.y_ >= view_.top_ && chunk.y_ <= view_.bottom_);
+        }
+
+        /// Inclusive rectangle of the chunks the client sees.
+        IntRect view_;
+        /// ChunkState of every chunk.
+        PODVector<unsigned char> chunks_;
+        /// Chunks changed outside of the view.
+        PODVector<unsigned> staleChunks_;
+        /// Chunks not sent yet, the next to send is the last.
+        PODVector<unsigned> unsentChunks_;
+        /// Sequence number of the next delta.
+        unsigned sequence_;
+        bool hasView_;
+        bool viewChanged_;
+    };
+
+    /// Move the unsent chunks in the view to the send list and order the rest by the distance to the view.
+    void PrioritizeUnsent(BoardGrid * grid, ConnectionState & state);
+
+    WeakPtr<Scene> scene_;
+    HashMap<Connection*, ConnectionState> connections_;
+    /// Dirty cells keyed by the chunk index in the high half, sorted to group them by the chunk.
+    PODVector<unsigned long long> dirty_;
+    /// Cells of the delta being sent.
+    PODVector<unsigned> cells_;
+    /// Chunks being sent.
+    PODVector<unsigned> sendChunks_;
+    /// Time since the last update of the stale chunks.
+    float staleTime_;
+    /// Number of the current round.
+    unsigned round_;
+    /// Message buffer.
+    VectorBuffer message_;
+};
+
+#endif // _BOARD_SERVER_H_INCLUDED__
@@ -0,0 +1,368 @@
+#include "BoardSession.h"
+#include "BoardGrid.h"
+#include "BoardProfiler.h"
+#include "BoardProtocol.h"
+#include "BoardServer.h"
+#include "TouchEvent.h"
+#include "TouchServer.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/VectorBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Scene/Scene.h>
+
+BoardSession::BoardSession(Context * context)
+    : Object(context)
+    , round_(0)
+    , roundTick_(0)
+    , roundTicks_(0)
+    , roundTime_(0.0f)
+    , numClaims_(0)
+    , numRejected_(0)
+    , tickQueued_(0)
+    , tickWon_(0)
+    , tickFirstWon_(0)
+    , autoTick_(true)
+    , tickRate_(DEFAULT_TICK_RATE)
+    , tick_(0)
+    , tickAcc_(0.0f)
+{}
+
+BoardSession::~BoardSession()
+{
+    Stop();
+}
+
+void BoardSession::Start(Scene * scene, int size, unsigned maxPlayers, const String & snapshotFile)
+{
+    Stop();
+
+    scene_ = scene;
+
+    // The whole board state is one local component, BoardServer sends it to the clients
+    // which create the cells locally
+    grid_ = scene_->CreateComponent<BoardGrid>(LOCAL);
+    grid_->SetSize(size, size);
+    boardServer_ = scene_->CreateComponent<BoardServer>(LOCAL);
+    touchServer_ = scene_->CreateComponent<TouchServer>(LOCAL);
+    SubscribeToEvent(touchServer_, E_TOUCHREACTION, URHO3D_HANDLER(BoardSession, HandleTouchReaction));
+    if(autoTick_)
+        SubscribeToEvent(E_UPDATE, URHO3D_HANDLER(BoardSession, HandleUpdate));
+    tick_ = 0;
+    tickAcc_ = 0.0f;
+    claimed_.Clear();
+    round_ = 0;
+    roundTick_ = 0;
+
+    // Player slots are the owner ids of the cells, the clients generate the colors from them
+    slots_.Reset(maxPlayers);
+    numClaims_ = numRejected_ = 0;
+
+    if(!snapshotFile.Empty())
+        OpenSnapshot(snapshotFile, size);
+    resolver_.Reset(*grid_);
+    scores_.Reset(grid_->GetWidth(), grid_->GetHeight());
+    for(auto cell : claimed_)
+        scores_.Claim(cell, grid_->GetOwner(cell));
+}
+
+void BoardSession::Stop()
+{
+    UnsubscribeFromAllEvents();
+
+    if(grid_)
+        grid_->Remove();
+    if(boardServer_)
+        boardServer_->Remove();
+    if(touchServer_)
+        touchServer_->Remove();
+
+    slots_.Reset(0);
+    snapshot_.Close();
+    journal_.Close();
+}
+
+bool BoardSession::AddConnection(Connection * connection)
+{
+    if(!scene_)
+        return false;
+
+    auto slot = slots_.Acquire(connection);
+    if(slot == NO_OWNER)
+        return false;
+
+    connection->SetScene(scene_);
+    snapshot_.SetSlotUsed(slot, true);
+
+    // The client needs its slot to predict own claims
+    VectorBuffer message;
+    message.WriteUByte(slot);
+    connection->SendMessage(MSG_PLAYER_SLOT, true, true, message);
+
+    boardServer_->SendSnapshot(connection);
+    return true;
+}
+
+void BoardSession::RemoveConnection(Connection * connection)
+{
+    auto slot = slots_.GetSlot(connection);
+    if(slot != NO_OWNER)
+        snapshot_.SetSlotUsed(slot, false);
+    slots_.Release(connection);
+}
+
+void BoardSession::SetTickRate(unsigned tickRate)
+{
+    tickRate_ = Max(tickRate, 1u);
+    SetRoundTime(roundTime_);
+}
+
+void BoardSession::SetRoundTime(float seconds)
+{
+    roundTime_ = Max(seconds, 0.0f);
+    roundTicks_ = static_cast<unsigned>(roundTime_ * tickRate_ + 0.5f);
+}
+
+void BoardSession::NewRound()
+{
+    if(!grid_)
+        return;
+
+    auto leader = scores_.GetLeader();
+    if(leader != NO_OWNER)
+        URHO3D_LOGINFOF("Round %u is over, slot %u leads with %u cells", round_, leader, scores_.GetCells(leader));
+
+    ++round_;
+    roundTick_ = tick_;
+
+    // Only the cells claimed in the round are touched, the clients get one reset message instead of the deltas
+    scores_.ResetCells(*grid_, claimed_);
+    grid_->ResetCells(claimed_);
+    resolver_.ResetCells(claimed_);
+    if(snapshot_.IsOpen())
+    {
+        for(auto cell : claimed_)
+            snapshot_.SetOwner(cell, NO_OWNER);
+    }
+    if(journal_.IsOpen())
+        journal_.Write(tick_, NO_OWNER, 0, round_);
+    if(boardServer_)
+        boardServer_->SendReset(round_);
+
+    URHO3D_LOGINFOF("Round %u started, %u cells freed", round_, claimed_.Size());
+    claimed_.Clear();
+}
+
+bool BoardSession::StartJournal(const String & fileName)
+{
+    if(!grid_)
+        return false;
+
+    // Replay starts from the empty board, the journal of a restored board is only good for the throughput
+    return journal_.Create(context_, fileName, grid_->GetWidth(), grid_->GetHeight());
+}
+
+BoardGrid * BoardSession::GetGrid() const
+{
+    return grid_;
+}
+
+TouchServer * BoardSession::GetTouchServer() const
+{
+    return touchServer_;
+}
+
+unsigned BoardSession::GetMemoryUse() const
+{
+    unsigned bytes = resolver_.GetMemoryUse() + scores_.GetMemoryUse() + claimed_.Capacity() * sizeof(unsigned);
+    if(grid_)
+        bytes += grid_->GetMemoryUse();
+    if(boardServer_)
+        bytes += boardServer_->GetMemoryUse();
+    return bytes;
+}
+
+void BoardSession::HandleUpdate(StringHash eventType, VariantMap & eventData)
+{
+    using namespace Update;
+
+    auto tickStep = 1.0f / tickRate_;
+    tickAcc_ += eventData[P_TIMESTEP].GetFloat();
+
+    unsigned numTicks = 0;
+    for(; tickAcc_ >= tickStep && numTicks < MAX_TICKS_PER_FRAME; ++numTicks)
+    {
+        tickAcc_ -= tickStep;
+        RunTick(tickStep);
+    }
+
+    // Too slow to catch up, drop the lag instead of spiraling
+    if(numTicks == MAX_TICKS_PER_FRAME)
+        tickAcc_ = Min(tickAcc_, tickStep);
+}
+
+void BoardSession::RunTick(float timeStep)
+{
+    auto profiler = GetSubsystem<BoardProfiler>();
+    if(profiler)
+        profiler->BeginTick();
+
+    // The claims of the tick are resolved together, the results go out before the acknowledgements of the touches
+    BeginTick();
+    ResolveClaims();
+    EndTick(timeStep);
+
+    if(profiler)
+        profiler->EndTick(timeStep);
+}
+
+void BoardSession::BeginTick()
+{
+    ++tick_;
+
+    // The last claims of the round went out on the previous tick, the reset goes before the touches of the new round
+    if(IsRoundOver())
+        NewRound();
+
+    if(touchServer_)
+        touchServer_->ProcessTouches(tick_);
+}
+
+void BoardSession::EndTick(float timeStep)
+{
+    if(boardServer_)
+        boardServer_->SendDelta(tick_, timeStep);
+    if(touchServer_)
+        touchServer_->SendAcks(tick_);
+    FlushFiles();
+}
+
+bool BoardSession::IsRoundOver() const
+{
+    if(!grid_ || !grid_->GetNumCells())
+        return false;
+    return claimed_.Size() >= grid_->GetNumCells() || (roundTicks_ && tick_ - roundTick_ > roundTicks_);
+}
+
+void BoardSession::HandleTouchReaction(StringHash eventType, VariantMap & eventData)
+{
+    using namespace TouchReaction;
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    auto cell = eventData[P_CELL].GetUInt();
+    auto slot = slots_.GetSlot(connection);
+    if(slot == NO_OWNER)
+        return;
+
+    if(journal_.IsOpen())
+        journal_.Write(eventData[P_TICK].GetUInt(), slot, cell, eventData[P_SEQUENCE].GetUInt());
+    QueueClaim(cell, slot);
+}
+
+void BoardSession::QueueClaim(unsigned cell, unsigned char slot)
+{
+    if(!grid_)
+        return;
+
+    if(!grid_->IsValid(cell))
+    {
+        ++numRejected_;
+        if(auto profiler = GetSubsystem<BoardProfiler>())
+            profiler->AddClaims(0, 1);
+        return;
+    }
+
+    resolver_.Queue(cell, slot);
+}
+
+void BoardSession::ResolveClaims()
+{
+    ProfileBlock block(GetSubsystem<BoardProfiler>(), PROFILE_CLAIMS);
+
+    BeginClaims();
+    if(grid_)
+        tickWon_ += resolver_.Resolve(GetSubsystem<WorkQueue>(), *grid_, claimed_);
+    EndClaims();
+}
+
+void BoardSession::BeginClaims()
+{
+    tickQueued_ = resolver_.GetNumClaims();
+    tickWon_ = 0;
+    tickFirstWon_ = claimed_.Size();
+}
+
+bool BoardSession::BeginClaimPass(WorkQueue * queue)
+{
+    return grid_ && resolver_.BeginPass(queue);
+}
+
+void BoardSession::EndClaimPass()
+{
+    tickWon_ += resolver_.EndPass(*grid_, claimed_);
+}
+
+void BoardSession::EndClaims()
+{
+    numClaims_ += tickWon_;
+    numRejected_ += tickQueued_ - tickWon_;
+
+    if(auto profiler = GetSubsystem<BoardProfiler>())
+    {
+        profiler->SetQueueDepth(QUEUE_CLAIMS, tickQueued_);
+        profiler->AddClaims(tickWon_, tickQueued_ - tickWon_);
+    }
+
+    for(unsigned i = tickFirstWon_; i < claimed_.Size(); ++i)
+    {
+        auto cell = claimed_[i];
+        auto owner = grid_->GetOwner(cell);
+        scores_.Claim(cell, owner);
+        if(snapshot_.IsOpen())
+            snapshot_.SetOwner(cell, owner);
+    }
+}
+
+void BoardSession::FlushFiles()
+{
+    // The idle ticks flush too, the records of the last burst must not wait for the next claim
+    if(flushTimer_.GetMSec(false) >= SNAPSHOT_FLUSH_INTERVAL * 1000.0f)
+    {
+        snapshot_.Flush(false);
+        journal_.Flush();
+        flushTimer_.Reset();
+    }
+}
+
+void BoardSession::OpenSnapshot(const String & fileName, int size)
+{
+    if(snapshot_.Open(fileName))
+    {
+        // The match goes on with the board of the snapshot, the clients get it in the join snapshot
+        if(snapshot_.GetWidth() != size || snapshot_.GetHeight() != size)
+            URHO3D_LOGINFOF("Board size %dx%d is restored from %s", snapshot_.GetWidth(), snapshot_.GetHeight(), fileName.CString());
+        grid_->SetSize(snapshot_.GetWidth(), snapshot_.GetHeight());
+        for(unsigned cell = 0; cell < grid_->GetNumCells(); ++cell)
+        {
+            grid_->SetOwner(cell, snapshot_.GetOwner(cell));
+            if(grid_->GetBusy(cell))
+                claimed_.Push(cell);
+        }
+        grid_->ClearDirty();
+
+        // The players of the crashed server still own their cells, give their slots to the new players last
+        for(unsigned slot = 1; slot <= MAX_PLAYERS; ++slot)
+        {
+            if(snapshot_.GetSlotUsed(slot))
+                slots_.Reserve(slot);
+        }
+        URHO3D_LOGINFOF("Board restored from %s", fileName.CString());
+    }
+    else if(!snapshot_.Reset(grid_->GetWidth(), grid_->GetHeight()))
+        snapshot_.Close();
+
+    flushTimer_.Reset();
+}
@@ -0,0 +1,153 @@
+#ifndef _BOARD_SESSION_H_INCLUDED__
+#define _BOARD_SESSION_H_INCLUDED__
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Timer.h>
+
+#include "BoardScores.h"
+#include "BoardSnapshotFile.h"
+#include "ClaimResolver.h"
+#include "PlayerSlots.h"
+#include "TouchJournal.h"
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Connection;
+    class Context;
+    class Scene;
+    class WorkQueue;
+}
+
+class BoardGrid;
+class BoardServer;
+class TouchServer;
+
+/// Default server tick rate, ticks per second.
+static const unsigned DEFAULT_TICK_RATE = 30;
+/// Maximum number of the ticks run in one frame to catch up, the rest of the lag is dropped.
+static const unsigned MAX_TICKS_PER_FRAME = 4;
+
+/// Server side of one board match: creates the board components in the scene,
+/// gives the player slots to the connections and resolves the claims.
+/// Runs at the fixed tick rate independent of the frame rate: every tick dispatches the touches, resolves the claims,
+/// sends the deltas and then the acknowledgements, all tagged with the tick number.
+/// A round ends when the board is full or its time is over, the next one resets only the claimed cells.
+class BoardSession : public Object
+{
+    URHO3D_OBJECT(BoardSession, Object);
+
+public:
+
+    explicit BoardSession(Context * context);
+    virtual ~BoardSession();
+
+    /// Create the board of the size x size cells for up to maxPlayers players. With the snapshot file set
+    /// the board is restored from it if valid, and every change is stored to it.
+    void Start(Scene * scene, int size, unsigned maxPlayers, const String & snapshotFile = String::EMPTY);
+    /// Remove the board components from the scene.
+    void Stop();
+    /// Record every touch dispatched to the claims from now on to the journal.
+    bool StartJournal(const String & fileName);
+    /// Run the ticks on E_UPDATE (default), or leave them to the owner calling BeginTick and EndTick. Set before Start.
+    void SetAutoTick(bool enable) { autoTick_ = enable; }
+    /// Set the number of the ticks per second.
+    void SetTickRate(unsigned tickRate);
+    unsigned GetTickRate() const { return tickRate_; }
+    /// Return the number of the last tick.
+    unsigned GetTick() const { return tick_; }
+    /// Set the round length in seconds, zero ends the round only when the board is full.
+    void SetRoundTime(float seconds);
+    /// Free all the claimed cells and start the next round. The connections, slots and components stay.
+    void NewRound();
+    /// Return the number of the current round.
+    unsigned GetRound() const { return round_; }
+
+    /// Give a slot to the connection and send it the board. Return false if all the slots are taken.
+    bool AddConnection(Connection * connection);
+    /// Release the slot of the connection.
+    void RemoveConnection(Connection * connection);
+
+    /// Queue the claim of the cell by the slot, resolved on the tick or by ResolveClaims.
+    void QueueClaim(unsigned cell, unsigned char slot);
+    /// Resolve the queued claims now.
+    void ResolveClaims();
+
+    /// Start the tick: the round change and the touches. The claims are resolved next, the tick ends with EndTick.
+    void BeginTick();
+    /// Send the results of the tick to the clients and flush the snapshot and the journal from time to time.
+    void EndTick(float timeStep);
+    /// Take the claims queued for the resolution passes.
+    void BeginClaims();
+    /// Add the next claim pass to the work queue. Return false if the claims are resolved.
+    bool BeginClaimPass(WorkQueue * queue);
+    /// Apply the pass completed by the work queue.
+    void EndClaimPass();
+    /// Count the resolved claims and store them to the snapshot.
+    void EndClaims();
+
+    BoardGrid * GetGrid() const;
+    TouchServer * GetTouchServer() const;
+    const PlayerSlots & GetSlots() const { return slots_; }
+    /// Return the cell counts and the regions of the players in the current round.
+    const BoardScores & GetScores() const { return scores_; }
+    /// Return the number of the accepted claims.
+    unsigned GetNumClaims() const { return numClaims_; }
+    /// Return the number of the touches of the busy cells.
+    unsigned GetNumRejected() const { return numRejected_; }
+    /// Return the bytes held by the board state, the claims and the replication state.
+    unsigned GetMemoryUse() const;
+
+private:
+
+    void HandleUpdate(StringHash eventType, VariantMap & eventData);
+    void HandleTouchReaction(StringHash eventType, VariantMap & eventData);
+    void RunTick(float timeStep);
+    /// Restore the board and the slots from the snapshot file or reset the file for the new board.
+    void OpenSnapshot(const String & fileName, int size);
+    /// Return true if the board is full or the round time is over.
+    bool IsRoundOver() const;
+    /// Flush the snapshot and the journal every SNAPSHOT_FLUSH_INTERVAL.
+    void FlushFiles();
+
+private:
+
+    WeakPtr<Scene> scene_;
+    WeakPtr<BoardGrid> grid_;
+    WeakPtr<BoardServer> boardServer_;
+    WeakPtr<TouchServer> touchServer_;
+    /// Player slots of the connections, used as the owners of the claimed cells.
+    PlayerSlots slots_;
+    /// Claims of the current tick, resolved on the worker threads.
+    ClaimResolver resolver_;
+    /// Ownership statistics updated on every won claim.
+    BoardScores scores_;
+    /// Crash recovery copy of the board.
+    BoardSnapshotFile snapshot_;
+    /// Record of the dispatched touches.
+    TouchJournal journal_;
+    /// Time since the snapshot and journal flush.
+    Timer flushTimer_;
+    /// Cells claimed in the current round, the only ones the next round has to free.
+    PODVector<unsigned> claimed_;
+    unsigned round_;
+    /// First tick of the current round.
+    unsigned roundTick_;
+    /// Round length in ticks, zero if unlimited.
+    unsigned roundTicks_;
+    float roundTime_;
+    unsigned numClaims_;
+    unsigned numRejected_;
+    /// Claims taken by BeginClaims, won by the passes so far and the first won cell in claimed_.
+    unsigned tickQueued_;
+    unsigned tickWon_;
+    unsigned tickFirstWon_;
+    bool autoTick_;
+    unsigned tickRate_;
+    unsigned tick_;
+    /// Frame time not consumed by the ticks.
+    float tickAcc_;
+};
+
+#endif // _BOARD_SESSION_H_INCLUDED__
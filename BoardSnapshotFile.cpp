@@ -0,0 +1,215 @@
+#include "BoardSnapshotFile.h"
+#include "PlayerSlots.h"
+
+#include <Urho3D/IO/Log.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct SnapshotHeader
+    {
+        char magic_[4];
+        unsigned version_;
+        int width_;
+        int height_;
+    };
+
+    const char SNAPSHOT_MAGIC[4] = { 'B', 'R', 'D', 'S' };
+    /// Slot table size, indexed by the slot including NO_OWNER.
+    const unsigned NUM_SLOT_ENTRIES = MAX_PLAYERS + 1;
+
+    unsigned GetFileSize(int width, int height)
+    {
+        return sizeof(SnapshotHeader) + NUM_SLOT_ENTRIES + static_cast<unsigned>(width * height);
+    }
+}
+
+BoardSnapshotFile::BoardSnapshotFile()
+    : file_(-1)
+    , data_(nullptr)
+    , size_(0)
+{}
+
+BoardSnapshotFile::~BoardSnapshotFile()
+{
+    Close();
+}
+
+#ifndef _WIN32
+
+bool BoardSnapshotFile::Open(const String & fileName)
+{
+    Close();
+
+    file_ = open(fileName.CString(), O_RDWR | O_CREAT, 0644);
+    if(file_ < 0)
+    {
+        URHO3D_LOGERRORF("Can not open the board snapshot %s", fileName.CString());
+        return false;
+    }
+    fileName_ = fileName;
+
+    struct stat info;
+    if(fstat(file_, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader))
+        return false;
+
+    SnapshotHeader header;
+    if(pread(file_, &header, sizeof(header), 0) != sizeof(header) ||
+        memcmp(header.magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.version_ != SNAPSHOT_VERSION)
+    {
+        URHO3D_LOGWARNINGF("Board snapshot %s is of another version, discarded", fileName.CString());
+        return false;
+    }
+
+    // A file cut by the crash before the resize is discarded as well
+    if(header.width_ < 0 || header.height_ < 0 || static_cast<unsigned>(info.st_size) != GetFileSize(header.width_, header.height_))
+    {
+        URHO3D_LOGWARNINGF("Board snapshot %s is truncated, discarded", fileName.CString());
+        return false;
+    }
+
+    return Map(static_cast<unsigned>(info.st_size));
+}
+
+bool BoardSnapshotFile::Reset(int width, int height)
+{
+    if(file_ < 0)
+        return false;
+
+    Unmap();
+
+    auto size = GetFileSize(width, height);
+    if(ftruncate(file_, 0) != 0 || ftruncate(file_, size) != 0 || !Map(size))
+    {
+        URHO3D_LOGERRORF("Can not resize the board snapshot %s", fileName_.CString());
+        return false;
+    }
+
+    // The new file is zero filled: all the cells and slots are free. The header goes last, so a crash
+    // in between leaves a file which is discarded
+    SnapshotHeader header;
+    memcpy(header.magic_, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version_ = SNAPSHOT_VERSION;
+    header.width_ = width;
+    header.height_ = height;
+    memcpy(data_, &header, sizeof(header));
+    Flush(true);
+    return true;
+}
+
+void BoardSnapshotFile::Close()
+{
+    if(data_)
+        Flush(true);
+    Unmap();
+    if(file_ >= 0)
+    {
+        close(file_);
+        file_ = -1;
+    }
+}
+
+void BoardSnapshotFile::Flush(bool sync)
+{
+    // The page cache keeps the stores if the process dies, the flush protects them from a crash of the system
+    if(data_)
+        msync(data_, size_, sync ? MS_SYNC : MS_ASYNC);
+}
+
+bool BoardSnapshotFile::Map(unsigned size)
+{
+    auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+    if(data == MAP_FAILED)
+        return false;
+
+    data_ = static_cast<unsigned char*>(data);
+    size_ = size;
+    return true;
+}
+
+void BoardSnapshotFile::Unmap()
+{
+    if(data_)
+    {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+#else
+
+bool BoardSnapshotFile::Open(const String & fileName)
+{
+    URHO3D_LOGERROR("Board snapshot is not supported on this platform");
+    return false;
+}
+
+bool BoardSnapshotFile::Reset(int width, int height)
+{
+    return false;
+}
+
+void BoardSnapshotFile::Close()
+{}
+
+void BoardSnapshotFile::Flush(bool sync)
+{}
+
+bool BoardSnapshotFile::Map(unsigned size)
+{
+    return false;
+}
+
+void BoardSnapshotFile::Unmap()
+{}
+
+#endif
+
+int BoardSnapshotFile::GetWidth() const
+{
+    return data_ ? reinterpret_cast<const SnapshotHeader*>(data_)->width_ : 0;
+}
+
+int BoardSnapshotFile::GetHeight() const
+{
+    return data_ ? reinterpret_cast<const SnapshotHeader*>(data_)->height_ : 0;
+}
+
+void BoardSnapshotFile::SetOwner(unsigned cell, unsigned char owner)
+{
+    if(data_ && cell < static_cast<unsigned>(GetWidth() * GetHeight()))
+        GetCells()[cell] = owner;
+}
+
+unsigned char BoardSnapshotFile::GetOwner(unsigned cell) const
+{
+    return data_ && cell < static_cast<unsigned>(GetWidth() * GetHeight()) ? GetCells()[cell] : 0;
+}
+
+void BoardSnapshotFile::SetSlotUsed(unsigned char slot, bool used)
+{
+    if(data_)
+        GetSlots()[slot] = used ? 1 : 0;
+}
+
+bool BoardSnapshotFile::GetSlotUsed(unsigned char slot) const
+{
+    return data_ && GetSlots()[slot] != 0;
+}
+
+unsigned char * BoardSnapshotFile::GetSlots() const
+{
+    return data_ + sizeof(SnapshotHeader);
+}
+
+unsigned char * BoardSnapshotFile::GetCells() const
+{
+    return data_ + sizeof(SnapshotHeader) + NUM_SLOT_ENTRIES;
+}
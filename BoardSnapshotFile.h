@@ -0,0 +1,57 @@
+#ifndef _BOARD_SNAPSHOT_FILE_H_INCLUDED__
+#define _BOARD_SNAPSHOT_FILE_H_INCLUDED__
+
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+/// Version of the snapshot file layout, a file of another version is discarded.
+static const unsigned SNAPSHOT_VERSION = 1;
+/// Interval of the asynchronous flush of the mapped file to the disk, in seconds.
+static const float SNAPSHOT_FLUSH_INTERVAL = 1.0f;
+
+/// Board owners and player slot table kept in a memory mapped file. Every change is a store to the mapping,
+/// so the file survives a crash of the server process and a restarted server resumes the match from it.
+/// Layout: header (magic, version, width, height), one byte per player slot (1 if used), one owner byte per cell.
+class BoardSnapshotFile
+{
+public:
+
+    BoardSnapshotFile();
+    ~BoardSnapshotFile();
+
+    /// Open or create the file. Return true if it holds a board of the current version, then GetWidth and GetHeight tell its size.
+    bool Open(const String & fileName);
+    /// Resize the file for the board, free all the cells and slots.
+    bool Reset(int width, int height);
+    /// Flush and unmap the file.
+    void Close();
+
+    bool IsOpen() const { return data_ != nullptr; }
+    int GetWidth() const;
+    int GetHeight() const;
+
+    void SetOwner(unsigned cell, unsigned char owner);
+    unsigned char GetOwner(unsigned cell) const;
+    void SetSlotUsed(unsigned char slot, bool used);
+    bool GetSlotUsed(unsigned char slot) const;
+
+    /// Schedule writing the changes to the disk, or write them now if sync.
+    void Flush(bool sync);
+
+private:
+
+    bool Map(unsigned size);
+    void Unmap();
+    unsigned char * GetSlots() const;
+    unsigned char * GetCells() const;
+
+private:
+
+    String fileName_;
+    int file_;
+    unsigned char * data_;
+    unsigned size_;
+};
+
+#endif // _BOARD_SNAPSHOT_FILE_H_INCLUDED__
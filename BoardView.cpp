@@ -0,0 +1,127 @@
+#include "BoardView.h"
+#include "BoardClient.h"
+#include "BoardGrid.h"
+#include "BoardRenderer.h"
+#include "PlayerSlots.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/Math/Plane.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+#include <Urho3D/Scene/SceneEvents.h>
+
+BoardView::BoardView(Context * context)
+    : Component(context)
+{}
+
+void BoardView::RegisterObject(Context * context)
+{
+    context->RegisterFactory<BoardView>();
+}
+
+void BoardView::OnSceneSet(Scene * scene)
+{
+    if(scene)
+    {
+        scene_ = GetScene();
+        SubscribeToEvent(E_SCENEUPDATE, [this](StringHash, VariantMap &)
+        {
+            Update();
+        });
+    }
+    else
+    {
+        UnsubscribeFromEvent(E_SCENEUPDATE);
+        RemoveBoard();
+    }
+}
+
+void BoardView::Update()
+{
+    auto grid = scene_->GetComponent<BoardGrid>();
+    if(!grid)
+    {
+        // Disconnected, the grid is gone
+        RemoveBoard();
+        return;
+    }
+
+    if(grid->GetSizeAttr() != size_)
+        CreateBoard(grid);
+
+    for(auto cell : grid->GetDirtyCells())
+        renderer_->SetCellColor(cell, GetSlotColor(grid->GetOwner(cell)));
+    grid->ClearDirty();
+
+    if(auto client = scene_->GetComponent<BoardClient>())
+        client->SetViewRegion(GetViewRegion(grid));
+}
+
+void BoardView::CreateBoard(BoardGrid * grid)
+{
+    RemoveBoard();
+
+    // The board is local, the server sends the grid state only
+    boardNode_ = scene_->CreateChild("Board", LOCAL);
+    renderer_ = boardNode_->CreateComponent<BoardRenderer>(LOCAL);
+    renderer_->SetMaterial(GetSubsystem<ResourceCache>()->GetResource<Material>("Materials/Board.xml"));
+    renderer_->SetGrid(grid);
+
+    size_ = grid->GetSizeAttr();
+    grid->ClearDirty();
+}
+
+void BoardView::RemoveBoard()
+{
+    if(boardNode_)
+    {
+        boardNode_->Remove();
+        boardNode_.Reset();
+    }
+    size_ = IntVector2::ZERO;
+}
+
+IntRect BoardView::GetViewRegion(BoardGrid * grid) const
+{
+    auto numChunks = grid->GetNumChunks();
+    IntRect all(0, 0, numChunks.x_ - 1, numChunks.y_ - 1);
+
+    auto viewport = GetSubsystem<Renderer>()->GetViewport(0);
+    auto camera = viewport ? viewport->GetCamera() : nullptr;
+    if(!camera || !boardNode_)
+        return all;
+
+    // Board plane and the camera in the board node space
+    auto toBoard = boardNode_->GetWorldTransform().Inverse();
+    Plane plane(Vector3::UP, Vector3::ZERO);
+    auto position = toBoard * camera->GetNode()->GetWorldPosition();
+
+    Rect area(Vector2(position.x_, position.z_), Vector2(position.x_, position.z_));
+    const Vector2 corners[] = { Vector2(0.0f, 0.0f), Vector2(1.0f, 0.0f), Vector2(0.0f, 1.0f), Vector2(1.0f, 1.0f) };
+    for(const auto & corner : corners)
+    {
+        auto ray = camera->GetScreenRay(corner.x_, corner.y_).Transformed(toBoard);
+        auto distance = ray.HitDistance(plane);
+
+        // Corner above the horizon, take the farthest visible point
+        if(distance == M_INFINITY || distance > camera->GetFarClip())
+            distance = camera->GetFarClip();
+
+        auto point = ray.origin_ + ray.direction_ * distance;
+        area.Merge(Vector2(point.x_, point.z_));
+    }
+
+    auto min = grid->GetCellAt(Vector3(area.min_.x_, 0.0f, area.min_.y_));
+    auto max = grid->GetCellAt(Vector3(area.max_.x_, 0.0f, area.max_.y_));
+
+    // One chunk of margin hides the latency of the view update
+    IntRect view(Max(min.x_ / CHUNK_SIZE - 1, 0), Max(min.y_ / CHUNK_SIZE - 1, 0),
+        Min(max.x_ / CHUNK_SIZE + 1, all.right_), Min(max.y_ / CHUNK_SIZE + 1, all.bottom_));
+    if(view.left_ > view.right_ || view.top_ > view.bottom_)
+        return IntRect(0, 0, 0, 0);
+    return view;
+}
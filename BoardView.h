@@ -0,0 +1,50 @@
+#ifndef _BOARD_VIEW_H_INCLUDED__
+#define _BOARD_VIEW_H_INCLUDED__
+
+#include <Urho3D/Scene/Component.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class Node;
+    class Scene;
+}
+
+class BoardGrid;
+class BoardRenderer;
+
+/// Client side presentation of the BoardGrid. Creates a local BoardRenderer and colors the cells by the owner.
+/// Tells BoardClient which chunks the camera sees, so the server sends the changes there first.
+class BoardView : public Component
+{
+    URHO3D_OBJECT(BoardView, Component);
+
+public:
+
+    explicit BoardView(Context * context);
+    static void RegisterObject(Context * context);
+
+protected:
+
+    void OnSceneSet(Scene * scene);
+
+private:
+
+    void Update();
+    void CreateBoard(BoardGrid * grid);
+    void RemoveBoard();
+    /// Return the inclusive rectangle of the chunks the camera of the main viewport sees.
+    IntRect GetViewRegion(BoardGrid * grid) const;
+
+private:
+
+    WeakPtr<Scene> scene_;
+    /// Local node of the board renderer.
+    SharedPtr<Node> boardNode_;
+    WeakPtr<BoardRenderer> renderer_;
+    IntVector2 size_;
+};
+
+#endif // _BOARD_VIEW_H_INCLUDED__
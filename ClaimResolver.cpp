@@ -0,0 +1,167 @@
+#include "ClaimResolver.h"
+#include "BoardGrid.h"
+
+#include <Urho3D/Core/WorkQueue.h>
+
+namespace
+{
+    /// Limit of the claims of one pass. The order is the claim index + 1 and must fit the 24 high bits of the owner.
+    const unsigned MAX_CLAIMS_PER_PASS = (1u << 24) - 1;
+
+    unsigned GetOrder(unsigned value)
+    {
+        return value >> 8;
+    }
+}
+
+ClaimResolver::ClaimResolver()
+    : numCells_(0)
+    , first_(0)
+    , count_(0)
+    , commit_(false)
+{}
+
+void ClaimResolver::Reset(const BoardGrid & grid)
+{
+    numCells_ = grid.GetNumCells();
+    owners_ = numCells_ ? new std::atomic<unsigned>[numCells_] : nullptr;
+    for(unsigned cell = 0; cell < numCells_; ++cell)
+        owners_[cell].store(grid.GetOwner(cell), std::memory_order_relaxed);
+    claims_.Clear();
+    first_ = count_ = 0;
+    commit_ = false;
+}
+
+void ClaimResolver::Queue(unsigned cell, unsigned char owner)
+{
+    Claim claim;
+    claim.cell_ = cell;
+    claim.owner_ = owner;
+    claim.won_ = false;
+    claims_.Push(claim);
+}
+
+void ClaimResolver::ResetCells(const PODVector<unsigned> & cells)
+{
+    for(auto cell : cells)
+    {
+        if(cell < numCells_)
+            owners_[cell].store(NO_OWNER, std::memory_order_relaxed);
+    }
+}
+
+unsigned ClaimResolver::Resolve(WorkQueue * queue, BoardGrid & grid, PODVector<unsigned> & won)
+{
+    // The main thread takes part in the pass and waits for the rest; completion orders the memory for the next pass
+    unsigned numWon = 0;
+    while(BeginPass(queue))
+    {
+        queue->Complete(M_MAX_UNSIGNED);
+        numWon += EndPass(grid, won);
+    }
+    return numWon;
+}
+
+bool ClaimResolver::BeginPass(WorkQueue * queue)
+{
+    if(first_ >= claims_.Size())
+    {
+        claims_.Clear();
+        first_ = 0;
+        return false;
+    }
+
+    // The commit pass must see all the orders published by the race pass
+    count_ = Min(claims_.Size() - first_, MAX_CLAIMS_PER_PASS);
+    AddPass(queue, commit_ ? &ClaimResolver::CommitClaims : &ClaimResolver::RaceClaims);
+    return true;
+}
+
+unsigned ClaimResolver::EndPass(BoardGrid & grid, PODVector<unsigned> & won)
+{
+    if(!commit_)
+    {
+        commit_ = true;
+        return 0;
+    }
+
+    unsigned numWon = 0;
+    for(unsigned i = first_; i < first_ + count_; ++i)
+    {
+        if(claims_[i].won_)
+        {
+            grid.SetOwner(claims_[i].cell_, claims_[i].owner_);
+            won.Push(claims_[i].cell_);
+            ++numWon;
+        }
+    }
+
+    first_ += count_;
+    commit_ = false;
+    return numWon;
+}
+
+unsigned ClaimResolver::GetMemoryUse() const
+{
+    return numCells_ * sizeof(std::atomic<unsigned>) + claims_.Capacity() * sizeof(Claim);
+}
+
+void ClaimResolver::RaceClaims(const WorkItem * item, unsigned threadIndex)
+{
+    auto resolver = static_cast<ClaimResolver*>(item->aux_);
+    auto begin = static_cast<Claim*>(item->start_);
+    auto end = static_cast<Claim*>(item->end_);
+
+    for(auto claim = begin; claim != end; ++claim)
+    {
+        if(claim->cell_ >= resolver->numCells_)
+            continue;
+
+        auto order = static_cast<unsigned>(claim - &resolver->claims_[resolver->first_]) + 1;
+        auto & owner = resolver->owners_[claim->cell_];
+        auto value = owner.load(std::memory_order_relaxed);
+
+        // Free cell or a later claim of the same cell, replace it with this one
+        while((value & 0xff) == NO_OWNER || GetOrder(value) > order)
+        {
+            if(owner.compare_exchange_weak(value, order << 8 | claim->owner_, std::memory_order_relaxed))
+                break;
+        }
+    }
+}
+
+void ClaimResolver::CommitClaims(const WorkItem * item, unsigned threadIndex)
+{
+    auto resolver = static_cast<ClaimResolver*>(item->aux_);
+    auto begin = static_cast<Claim*>(item->start_);
+    auto end = static_cast<Claim*>(item->end_);
+
+    for(auto claim = begin; claim != end; ++claim)
+    {
+        if(claim->cell_ >= resolver->numCells_)
+            continue;
+
+        // Only the winner sees its own order, the losers see it or the committed owner without the order
+        auto order = static_cast<unsigned>(claim - &resolver->claims_[resolver->first_]) + 1;
+        auto & owner = resolver->owners_[claim->cell_];
+        if(GetOrder(owner.load(std::memory_order_relaxed)) == order)
+        {
+            owner.store(claim->owner_, std::memory_order_relaxed);
+            claim->won_ = true;
+        }
+    }
+}
+
+void ClaimResolver::AddPass(WorkQueue * queue, void (*pass)(const WorkItem *, unsigned))
+{
+    for(unsigned i = first_; i < first_ + count_; i += CLAIMS_PER_WORK_ITEM)
+    {
+        auto item = queue->GetFreeItem();
+        item->workFunction_ = pass;
+        item->start_ = &claims_[i];
+        item->end_ = &claims_[0] + Min(i + CLAIMS_PER_WORK_ITEM, first_ + count_);
+        item->aux_ = this;
+        item->priority_ = M_MAX_UNSIGNED;
+        queue->AddWorkItem(item);
+    }
+}
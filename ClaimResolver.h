@@ -0,0 +1,81 @@
+#ifndef _CLAIM_RESOLVER_H_INCLUDED__
+#define _CLAIM_RESOLVER_H_INCLUDED__
+
+#include <Urho3D/Container/ArrayPtr.h>
+#include <Urho3D/Container/Vector.h>
+
+#include <atomic>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class WorkQueue;
+    struct WorkItem;
+}
+
+class BoardGrid;
+
+/// Number of the claims resolved by one work item.
+static const unsigned CLAIMS_PER_WORK_ITEM = 1024;
+
+/// Resolves the claims of one tick on the worker threads. The cell owners live in an atomic array,
+/// the claims of the same free cell race by CAS and the earliest queued claim wins whatever thread runs it.
+/// Only the won cells are written back to BoardGrid on the main thread, which marks them for the deltas.
+class ClaimResolver
+{
+public:
+
+    ClaimResolver();
+
+    /// Copy the owners of the grid and drop the queued claims.
+    void Reset(const BoardGrid & grid);
+    /// Queue the claim of the cell for the next Resolve.
+    void Queue(unsigned cell, unsigned char owner);
+    /// Release the cells, the grid is reset by the caller.
+    void ResetCells(const PODVector<unsigned> & cells);
+    /// Resolve the queued claims on the work queue, apply the won ones to the grid and append their cells. Return the number of the won claims.
+    unsigned Resolve(WorkQueue * queue, BoardGrid & grid, PODVector<unsigned> & won);
+    /// Add the work items of the next pass to the queue without waiting, so the passes of several resolvers run together.
+    /// Return false if all the claims are resolved.
+    bool BeginPass(WorkQueue * queue);
+    /// Finish the pass after the queue completes it. Apply the won claims of a commit pass to the grid and append their cells,
+    /// return the number of the won claims.
+    unsigned EndPass(BoardGrid & grid, PODVector<unsigned> & won);
+
+    bool HasClaims() const { return !claims_.Empty(); }
+    unsigned GetNumClaims() const { return claims_.Size(); }
+    /// Return the bytes held by the owners and the claims.
+    unsigned GetMemoryUse() const;
+
+private:
+
+    struct Claim
+    {
+        unsigned cell_;
+        unsigned char owner_;
+        bool won_;
+    };
+
+    /// Publish the claims of the work item range: keep the earliest claim of every free cell.
+    static void RaceClaims(const WorkItem * item, unsigned threadIndex);
+    /// Find the winners of the work item range and commit their owners.
+    static void CommitClaims(const WorkItem * item, unsigned threadIndex);
+    void AddPass(WorkQueue * queue, void (*pass)(const WorkItem *, unsigned));
+
+private:
+
+    /// Owner of every cell in the low byte. While a claim is resolved, the high bits hold its order + 1.
+    SharedArrayPtr<std::atomic<unsigned> > owners_;
+    unsigned numCells_;
+    /// Claims in the order of arrival.
+    PODVector<Claim> claims_;
+    /// Index of the first claim of the pass being run.
+    unsigned first_;
+    /// Number of the claims of the pass being run.
+    unsigned count_;
+    /// The pass being run commits the winners of the race pass.
+    bool commit_;
+};
+
+#endif // _CLAIM_RESOLVER_H_INCLUDED__
@@ -0,0 +1,264 @@
+#include "BoardLoadTest.h"
+
+#include "BoardGrid.h"
+#include "BoardProfiler.h"
+#include "BoardServer.h"
+#include "BoardSession.h"
+#include "StringFormat.h"
+#include "TouchServer.h"
+
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+#include <Urho3D/Scene/Scene.h>
+
+/// Time to wait for all the bots to connect before starting anyway, in seconds.
+static const float CONNECT_TIMEOUT = 10.0f;
+
+URHO3D_DEFINE_APPLICATION_MAIN(BoardLoadTest)
+
+namespace
+{
+    /// Return the percentile of the sorted values.
+    float Percentile(const PODVector<float> & values, float percentile)
+    {
+        if(values.Empty())
+            return 0.0f;
+        auto index = static_cast<unsigned>(percentile * (values.Size() - 1) + 0.5f);
+        return values[Min(index, values.Size() - 1)];
+    }
+
+    String FormatStats(PODVector<float> & values)
+    {
+        Sort(values.Begin(), values.End());
+        return FormatString("{\"p50\":%.3f,\"p99\":%.3f,\"max\":%.3f,\"count\":%u}",
+            Percentile(values, 0.5f), Percentile(values, 0.99f), values.Empty() ? 0.0f : values.Back(), values.Size());
+    }
+}
+
+BoardLoadTest::BoardLoadTest(Context * context)
+    : Application(context)
+    , elapsed_(0.0f)
+    , running_(false)
+    , numClients_(100)
+    , touchRate_(5.0f)
+    , duration_(10.0f)
+    , seed_(1)
+    , boardSize_(64)
+    , port_(2346)
+    , tickRate_(DEFAULT_TICK_RATE)
+    , pattern_(TP_RANDOM)
+{
+    TouchServer::RegisterObject(context);
+    BoardGrid::RegisterObject(context);
+    BoardServer::RegisterObject(context);
+}
+
+void BoardLoadTest::Setup()
+{
+    ParseArguments(GetArguments());
+
+    engineParameters_[EP_HEADLESS] = true;
+    engineParameters_[EP_SOUND] = false;
+    engineParameters_[EP_LOG_NAME] = "BoardLoadTest.log";
+}
+
+void BoardLoadTest::Start()
+{
+    // Run as fast as possible, the frame limiter sleep would be counted as the tick time
+    engine_->SetMaxFps(0);
+
+    scene_ = MakeShared<Scene>(context_);
+    if(!GetSubsystem<Network>()->StartServer(port_))
+    {
+        URHO3D_LOGERRORF("Failed to start server on port %d", port_);
+        engine_->Exit();
+        return;
+    }
+
+    if(!metricsOutput_.Empty() || !traceOutput_.Empty())
+    {
+        auto profiler = new BoardProfiler(context_);
+        context_->RegisterSubsystem(profiler);
+        profiler->SetMetricsOutput(metricsOutput_);
+        profiler->SetTraceOutput(traceOutput_);
+    }
+
+    session_ = MakeShared<BoardSession>(context_);
+    session_->SetTickRate(tickRate_);
+    session_->Start(scene_, boardSize_, MAX_PLAYERS);
+    if(numClients_ > MAX_PLAYERS)
+        URHO3D_LOGWARNINGF("Only %u of %u clients get a player slot", MAX_PLAYERS, numClients_);
+
+    SubscribeToEvent(E_CLIENTCONNECTED, URHO3D_HANDLER(BoardLoadTest, HandleClientConnected));
+    SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(BoardLoadTest, HandleClientDisconnected));
+    SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(BoardLoadTest, HandleEndFrame));
+
+    // Every bot has its own context, the Network subsystem holds one server connection only
+    for(unsigned i = 0; i < numClients_; ++i)
+    {
+        auto context = MakeShared<Context>();
+        context->RegisterSubsystem(new Network(context));
+        botContexts_.Push(context);
+
+        auto bot = MakeShared<LoadTestBot>(context, clock_, seed_ * 7919u + i);
+        bot->Connect("127.0.0.1", port_);
+        bots_.Push(bot);
+    }
+
+    clock_.Reset();
+    tickTimer_.Reset();
+}
+
+void BoardLoadTest::Stop()
+{
+    for(auto & bot : bots_)
+        bot->Disconnect();
+    bots_.Clear();
+    botContexts_.Clear();
+    session_.Reset();
+}
+
+void BoardLoadTest::ParseArguments(const Vector<String> & arguments)
+{
+    for(unsigned i = 0; i + 1 < arguments.Size(); ++i)
+    {
+        String argument = arguments[i].ToLower();
+        const String & value = arguments[i + 1];
+
+        if(argument == "--clients")
+            numClients_ = Max(ToUInt(value), 1u);
+        else if(argument == "--rate")
+            touchRate_ = Max(ToFloat(value), 0.0f);
+        else if(argument == "--duration")
+            duration_ = Max(ToFloat(value), 0.1f);
+        else if(argument == "--seed")
+            seed_ = ToUInt(value);
+        else if(argument == "--size")
+            boardSize_ = Max(ToInt(value), 1);
+        else if(argument == "--port")
+            port_ = static_cast<unsigned short>(ToUInt(value));
+        else if(argument == "--tick")
+            tickRate_ = Clamp(ToUInt(value), 1u, 1000u);
+        else if(argument == "--pattern")
+            pattern_ = value == "sweep" ? TP_SWEEP : (value == "hotspot" ? TP_HOTSPOT : TP_RANDOM);
+        else if(argument == "--output")
+            output_ = value;
+        else if(argument == "--metrics")
+            metricsOutput_ = value;
+        else if(argument == "--trace")
+            traceOutput_ = value;
+        else
+            continue;
+        ++i;
+    }
+}
+
+void BoardLoadTest::HandleEndFrame(StringHash eventType, VariantMap & eventData)
+{
+    // Everything between the bot updates is the server frame
+    if(running_)
+        tickTimes_.Push(tickTimer_.GetUSec(false) / 1000.0f);
+
+    auto timeStep = GetSubsystem<Time>()->GetTimeStep();
+    for(auto & bot : bots_)
+        bot->Update(timeStep, running_ ? touchRate_ : 0.0f, pattern_);
+
+    if(!running_)
+    {
+        unsigned ready = 0;
+        for(auto & bot : bots_)
+        {
+            if(bot->IsReady())
+                ++ready;
+        }
+
+        if(ready == bots_.Size() || clock_.GetUSec(false) > CONNECT_TIMEOUT * 1000000)
+        {
+            URHO3D_LOGINFO(FormatString("%u of %u clients connected, running for %.1f seconds", ready, bots_.Size(), duration_));
+            running_ = true;
+        }
+    }
+    else
+    {
+        elapsed_ += timeStep;
+        if(elapsed_ >= duration_)
+        {
+            Report();
+            engine_->Exit();
+        }
+    }
+
+    tickTimer_.Reset();
+}
+
+void BoardLoadTest::HandleClientConnected(StringHash eventType, VariantMap & eventData)
+{
+    using namespace ClientConnected;
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    if(!session_->AddConnection(connection))
+        connection->Disconnect();
+}
+
+void BoardLoadTest::HandleClientDisconnected(StringHash eventType, VariantMap & eventData)
+{
+    using namespace ClientDisconnected;
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    session_->RemoveConnection(connection);
+}
+
+void BoardLoadTest::Report()
+{
+    PODVector<float> latencies;
+    unsigned numTouches = 0;
+    unsigned connected = 0;
+    unsigned long long bytesSent = 0;
+    unsigned long long bytesReceived = 0;
+    for(auto & bot : bots_)
+    {
+        latencies.Push(bot->GetLatencies());
+        numTouches += bot->GetNumTouches();
+        bytesSent += bot->GetBytesSent();
+        bytesReceived += bot->GetBytesReceived();
+        if(bot->IsReady())
+            ++connected;
+    }
+
+    auto perClient = connected ? 1.0f / (connected * elapsed_) : 0.0f;
+    String report;
+    report += FormatString("{\"clients\":%u,\"connected\":%u,\"pattern\":%d,\"seed\":%u,\"board\":%d,\"duration\":%.3f,",
+        bots_.Size(), connected, pattern_, seed_, boardSize_, elapsed_);
+    report += FormatString("\"touches\":%u,\"touches_per_sec\":%.1f,", numTouches, numTouches / elapsed_);
+    report += FormatString("\"claims\":%u,\"claims_per_sec\":%.1f,\"rejected\":%u,",
+        session_->GetNumClaims(), session_->GetNumClaims() / elapsed_, session_->GetNumRejected());
+    if(auto touchServer = session_->GetTouchServer())
+    {
+        const auto & stats = touchServer->GetTotalStats();
+        report.AppendWithFormat("\"dropped\":{\"duplicates\":%u,\"owned\":%u,\"rate_limited\":%u,\"overflow\":%u},",
+            stats.duplicates_, stats.owned_, stats.rateLimited_, stats.overflow_);
+    }
+    report += FormatString("\"client_up_bytes_per_sec\":%.1f,\"client_down_bytes_per_sec\":%.1f,",
+        bytesSent * perClient, bytesReceived * perClient);
+    report += "\"latency_ms\":" + FormatStats(latencies) + ",";
+    report += "\"tick_ms\":" + FormatStats(tickTimes_) + "}";
+
+    PrintLine(report);
+
+    if(!output_.Empty())
+    {
+        File file(context_, output_, FILE_WRITE);
+        if(file.IsOpen())
+            file.WriteLine(report);
+        else
+            URHO3D_LOGERRORF("Can not write report to %s", output_.CString());
+    }
+}
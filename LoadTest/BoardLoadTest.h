@@ -0,0 +1,72 @@
+#ifndef _BOARD_LOAD_TEST_H_INCLUDED__
+#define _BOARD_LOAD_TEST_H_INCLUDED__
+
+#include <Urho3D/Engine/Application.h>
+#include <Urho3D/Core/Timer.h>
+
+#include "LoadTestBot.h"
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Scene;
+}
+
+class BoardSession;
+
+/// Headless load test: runs the board server and the simulated clients in one process over the loopback
+/// and reports the latency, tick time, bandwidth and claim rate.
+class BoardLoadTest : public Application
+{
+    URHO3D_OBJECT(BoardLoadTest, Application);
+
+public:
+
+    explicit BoardLoadTest(Context * context);
+
+    virtual void Setup();
+    virtual void Start();
+    virtual void Stop();
+
+private:
+
+    void ParseArguments(const Vector<String> & arguments);
+    void HandleEndFrame(StringHash eventType, VariantMap & eventData);
+    void HandleClientConnected(StringHash eventType, VariantMap & eventData);
+    void HandleClientDisconnected(StringHash eventType, VariantMap & eventData);
+    /// Print the JSON report and write it to the output file if set.
+    void Report();
+
+private:
+
+    SharedPtr<Scene> scene_;
+    SharedPtr<BoardSession> session_;
+    /// Contexts of the bots, released after the bots.
+    Vector<SharedPtr<Context> > botContexts_;
+    Vector<SharedPtr<LoadTestBot> > bots_;
+
+    /// Run clock, all the latencies are measured by it.
+    HiresTimer clock_;
+    /// Server frame time since the end of the previous bot update.
+    HiresTimer tickTimer_;
+    PODVector<float> tickTimes_;
+    /// Run time with all the bots connected, in seconds.
+    float elapsed_;
+    bool running_;
+
+    unsigned numClients_;
+    float touchRate_;
+    float duration_;
+    unsigned seed_;
+    int boardSize_;
+    unsigned short port_;
+    unsigned tickRate_;
+    TouchPattern pattern_;
+    String output_;
+    /// Server profiler outputs.
+    String metricsOutput_;
+    String traceOutput_;
+};
+
+#endif // _BOARD_LOAD_TEST_H_INCLUDED__
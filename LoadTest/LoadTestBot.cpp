@@ -0,0 +1,153 @@
+#include "LoadTestBot.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/Network/Connection.h>
+#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
+
+/// Side of the hotspot area in cells.
+static const int HOTSPOT_SIZE = 4;
+
+LoadTestBot::LoadTestBot(Context * context, HiresTimer & clock, unsigned seed)
+    : Object(context)
+    , clock_(clock)
+    , random_(seed ? seed : 1)
+    , width_(0)
+    , height_(0)
+    , sweepCell_(0)
+    , sequence_(0)
+    , touchAcc_(0.0f)
+    , sendAcc_(0.0f)
+    , numTouches_(0)
+    , bytesSent_(0)
+    , bytesReceived_(0)
+{
+    SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(LoadTestBot, HandleNetworkMessage));
+}
+
+void LoadTestBot::Connect(const String & address, unsigned short port)
+{
+    // No scene, the bot reads the board messages only
+    GetSubsystem<Network>()->Connect(address, port, nullptr);
+}
+
+void LoadTestBot::Disconnect()
+{
+    GetSubsystem<Network>()->Disconnect();
+}
+
+void LoadTestBot::Update(float timeStep, float touchRate, TouchPattern pattern)
+{
+    auto network = GetSubsystem<Network>();
+    network->Update(timeStep);
+
+    auto connection = network->GetServerConnection();
+    if(!connection || !connection->IsConnected() || !width_)
+    {
+        network->PostUpdate(timeStep);
+        return;
+    }
+
+    // Touches are spread evenly over the simulated time, so the run is the same for the same seed
+    touchAcc_ += timeStep * touchRate;
+    while(touchAcc_ >= 1.0f)
+    {
+        touchAcc_ -= 1.0f;
+
+        TouchData touch;
+        touch.cell_ = NextCell(pattern);
+        touch.sequence_ = sequence_++;
+        touch.time_ = static_cast<unsigned>(clock_.GetUSec(false) / 1000);
+        touches_.Push(touch);
+        ++numTouches_;
+
+        SentTouch sent;
+        sent.sequence_ = touch.sequence_;
+        sent.time_ = clock_.GetUSec(false);
+        sent_.Push(sent);
+    }
+
+    // Flush at the network update rate like TouchClient does
+    sendAcc_ += timeStep;
+    if(sendAcc_ >= 1.0f / network->GetUpdateFps() && touches_.Size())
+    {
+        sendAcc_ = 0.0f;
+        message_.Clear();
+        WriteTouchBatch(message_, touches_);
+        connection->SendMessage(MSG_TOUCH_BATCH, true, true, message_);
+        bytesSent_ += message_.GetSize();
+        touches_.Clear();
+    }
+
+    network->PostUpdate(timeStep);
+}
+
+bool LoadTestBot::IsConnected() const
+{
+    auto connection = GetSubsystem<Network>()->GetServerConnection();
+    return connection && connection->IsConnected();
+}
+
+void LoadTestBot::HandleNetworkMessage(StringHash eventType, VariantMap & eventData)
+{
+    using namespace NetworkMessage;
+
+    const auto & data = eventData[P_DATA].GetBuffer();
+    bytesReceived_ += data.Size();
+
+    MemoryBuffer message(data);
+    switch(eventData[P_MESSAGEID].GetInt())
+    {
+    case MSG_BOARD_SNAPSHOT:
+        width_ = message.ReadVLE();
+        height_ = message.ReadVLE();
+        break;
+
+    case MSG_TOUCH_ACK:
+        {
+            // The acknowledgement follows the board deltas with the results of the touches
+            auto next = message.ReadVLE();
+            auto now = clock_.GetUSec(false);
+            unsigned count = 0;
+            for(; count < sent_.Size() && sent_[count].sequence_ < next; ++count)
+                latencies_.Push((now - sent_[count].time_) / 1000.0f);
+            sent_.Erase(0, count);
+        }
+        break;
+    }
+}
+
+unsigned LoadTestBot::NextRandom()
+{
+    // xorshift32, independent from the global Urho3D random
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
+
+unsigned LoadTestBot::NextCell(TouchPattern pattern)
+{
+    unsigned numCells = width_ * height_;
+    switch(pattern)
+    {
+    case TP_SWEEP:
+        if(!sequence_)
+            sweepCell_ = NextRandom() % numCells;
+        sweepCell_ = (sweepCell_ + 1) % numCells;
+        return sweepCell_;
+
+    case TP_HOTSPOT:
+        {
+            auto size = Min(HOTSPOT_SIZE, Min(width_, height_));
+            auto x = (width_ - size) / 2 + static_cast<int>(NextRandom() % size);
+            auto y = (height_ - size) / 2 + static_cast<int>(NextRandom() % size);
+            return static_cast<unsigned>(y * width_ + x);
+        }
+
+    default:
+        return NextRandom() % numCells;
+    }
+}
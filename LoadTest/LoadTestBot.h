@@ -0,0 +1,85 @@
+#ifndef _LOAD_TEST_BOT_H_INCLUDED__
+#define _LOAD_TEST_BOT_H_INCLUDED__
+
+#include <Urho3D/Core/Object.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "BoardProtocol.h"
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class HiresTimer;
+}
+
+/// Touch pattern of a simulated client.
+enum TouchPattern
+{
+    /// Uniformly random cells.
+    TP_RANDOM = 0,
+    /// Consecutive cells from a random start.
+    TP_SWEEP,
+    /// Random cells of a small area shared by all the clients, for claim races.
+    TP_HOTSPOT
+};
+
+/// Simulated client. Lives in its own context with its own Network subsystem, connects to the server
+/// over the loopback and touches the cells with the seeded pattern at the fixed rate.
+class LoadTestBot : public Object
+{
+    URHO3D_OBJECT(LoadTestBot, Object);
+
+public:
+
+    LoadTestBot(Context * context, HiresTimer & clock, unsigned seed);
+
+    void Connect(const String & address, unsigned short port);
+    void Disconnect();
+    /// Pump the network and generate the touches for the time step.
+    void Update(float timeStep, float touchRate, TouchPattern pattern);
+
+    bool IsConnected() const;
+    /// Return true when the board snapshot is received and the bot can touch.
+    bool IsReady() const { return width_ > 0; }
+    /// Return touch to acknowledgement latencies in milliseconds.
+    const PODVector<float> & GetLatencies() const { return latencies_; }
+    unsigned GetNumTouches() const { return numTouches_; }
+    unsigned long long GetBytesSent() const { return bytesSent_; }
+    unsigned long long GetBytesReceived() const { return bytesReceived_; }
+
+private:
+
+    void HandleNetworkMessage(StringHash eventType, VariantMap & eventData);
+    unsigned NextRandom();
+    unsigned NextCell(TouchPattern pattern);
+
+private:
+
+    struct SentTouch
+    {
+        unsigned sequence_;
+        long long time_;
+    };
+
+    HiresTimer & clock_;
+    unsigned random_;
+    /// Board size from the snapshot.
+    int width_;
+    int height_;
+    unsigned sweepCell_;
+    unsigned sequence_;
+    float touchAcc_;
+    float sendAcc_;
+    PODVector<TouchData> touches_;
+    /// Creation time of the touches waiting for the acknowledgement.
+    PODVector<SentTouch> sent_;
+    PODVector<float> latencies_;
+    unsigned numTouches_;
+    unsigned long long bytesSent_;
+    unsigned long long bytesReceived_;
+    VectorBuffer message_;
+};
+
+#endif // _LOAD_TEST_BOT_H_INCLUDED__
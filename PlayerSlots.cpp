@@ -0,0 +1,79 @@
+#include "PlayerSlots.h"
+#include "BoardGrid.h"
+
+Color GetSlotColor(unsigned char slot)
+{
+    if(slot == NO_OWNER)
+        return Color(0.7f, 0.7f, 0.7f);
+
+    // Golden ratio steps keep the hues of the neighbour slots far apart
+    Color color;
+    color.FromHSV(fmodf(slot * 0.618034f, 1.0f), 0.85f, 0.75f, 1.0f);
+    return color;
+}
+
+PlayerSlots::PlayerSlots()
+    : firstFree_(0)
+    , numFree_(0)
+{}
+
+void PlayerSlots::Reset(unsigned numSlots)
+{
+    numSlots = Min(numSlots, MAX_PLAYERS);
+
+    slots_.Clear();
+    free_.Resize(numSlots);
+    for(unsigned i = 0; i < numSlots; ++i)
+        free_[i] = static_cast<unsigned char>(i + 1);
+    firstFree_ = 0;
+    numFree_ = numSlots;
+}
+
+unsigned char PlayerSlots::Acquire(Connection * connection)
+{
+    auto it = slots_.Find(connection);
+    if(it != slots_.End())
+        return it->second_;
+
+    if(!numFree_)
+        return NO_OWNER;
+
+    auto slot = free_[firstFree_];
+    firstFree_ = (firstFree_ + 1) % free_.Size();
+    --numFree_;
+    slots_[connection] = slot;
+    return slot;
+}
+
+void PlayerSlots::Release(Connection * connection)
+{
+    auto it = slots_.Find(connection);
+    if(it != slots_.End())
+    {
+        // The ring holds all the slots, so a released one always fits
+        free_[(firstFree_ + numFree_) % free_.Size()] = it->second_;
+        ++numFree_;
+        slots_.Erase(it);
+    }
+}
+
+void PlayerSlots::Reserve(unsigned char slot)
+{
+    // Only on the restore, shift the slots after it one place closer to the head
+    for(unsigned i = 0; i < numFree_; ++i)
+    {
+        if(free_[(firstFree_ + i) % free_.Size()] != slot)
+            continue;
+
+        for(; i + 1 < numFree_; ++i)
+            free_[(firstFree_ + i) % free_.Size()] = free_[(firstFree_ + i + 1) % free_.Size()];
+        free_[(firstFree_ + i) % free_.Size()] = slot;
+        return;
+    }
+}
+
+unsigned char PlayerSlots::GetSlot(Connection * connection) const
+{
+    auto it = slots_.Find(connection);
+    return it != slots_.End() ? it->second_ : NO_OWNER;
+}
@@ -0,0 +1,52 @@
+#ifndef _PLAYER_SLOTS_H_INCLUDED__
+#define _PLAYER_SLOTS_H_INCLUDED__
+
+#include <Urho3D/Container/HashMap.h>
+#include <Urho3D/Math/Color.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Connection;
+}
+
+/// Maximum number of players, limited by the one byte owner of BoardGrid.
+static const unsigned MAX_PLAYERS = 255;
+
+/// Return the color of the player slot, generated from the slot number. NO_OWNER is the empty cell color.
+Color GetSlotColor(unsigned char slot);
+
+/// Allocates player slots (BoardGrid owner ids) to the connections and recycles them in O(1).
+/// The free slots are a FIFO ring: a released slot is given out after all the other free ones, so a joining player
+/// does not take over the slot, the color and the cells of the player who just left.
+class PlayerSlots
+{
+public:
+
+    PlayerSlots();
+
+    /// Release all the slots and make slots 1..numSlots available.
+    void Reset(unsigned numSlots);
+    /// Assign a free slot to the connection. Return NO_OWNER if all the slots are taken.
+    unsigned char Acquire(Connection * connection);
+    /// Return the slot of the connection to the end of the free slots.
+    void Release(Connection * connection);
+    /// Move the free slot to the end of the free slots, so it is given out after all the others.
+    void Reserve(unsigned char slot);
+
+    /// Return the slot of the connection or NO_OWNER.
+    unsigned char GetSlot(Connection * connection) const;
+    unsigned GetNumFree() const { return numFree_; }
+    unsigned GetNumUsed() const { return slots_.Size(); }
+
+private:
+
+    /// Ring of the free slots, numFree_ of them from firstFree_ on. The first one is given out first.
+    PODVector<unsigned char> free_;
+    unsigned firstFree_;
+    unsigned numFree_;
+    HashMap<Connection*, unsigned char> slots_;
+};
+
+#endif // _PLAYER_SLOTS_H_INCLUDED__
@@ -0,0 +1,28 @@
+#include "StringFormat.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+String FormatString(const char * format, ...)
+{
+    // The metrics lines fit the stack buffer, a longer string is formatted again into its own size
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    va_list retry;
+    va_copy(retry, args);
+    auto length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    String result;
+    if(length >= 0 && static_cast<unsigned>(length) < sizeof(buffer))
+        result = buffer;
+    else if(length > 0)
+    {
+        // The string keeps the room for the terminating zero
+        result.Resize(static_cast<unsigned>(length));
+        vsnprintf(&result[0], static_cast<size_t>(length) + 1, format, retry);
+    }
+    va_end(retry);
+    return result;
+}
@@ -0,0 +1,12 @@
+#ifndef _STRING_FORMAT_H_INCLUDED__
+#define _STRING_FORMAT_H_INCLUDED__
+
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+/// Return the string formatted by the C printf rules. ToString, String::AppendWithFormat and the formatted log macros
+/// take only the one letter specifiers and misread the arguments after %.3f, %08x or %lld, the metrics lines use this.
+String FormatString(const char * format, ...);
+
+#endif // _STRING_FORMAT_H_INCLUDED__
@@ -0,0 +1,38 @@
+#include "BoardTests.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Main.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/FileSystem.h>
+
+namespace
+{
+    unsigned numChecks = 0;
+    unsigned numFailures = 0;
+}
+
+bool Check(bool condition, const char * what, const String & test)
+{
+    ++numChecks;
+    if(!condition)
+    {
+        ++numFailures;
+        PrintLine(ToString("FAIL %s: %s", test.CString(), what), true);
+    }
+    return condition;
+}
+
+int RunTests()
+{
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new FileSystem(context));
+    RunProtocolTests(context);
+    RunPlayerSlotsTests();
+    RunProfilerTests(context);
+
+    PrintLine(ToString("%u checks, %u failed", numChecks, numFailures));
+    return numFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+URHO3D_DEFINE_MAIN(RunTests())
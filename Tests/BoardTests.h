@@ -0,0 +1,23 @@
+#ifndef _BOARD_TESTS_H_INCLUDED__
+#define _BOARD_TESTS_H_INCLUDED__
+
+#include <Urho3D/Container/Str.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+}
+
+/// Count the check and print the failure. Return the condition.
+bool Check(bool condition, const char * what, const String & test);
+
+/// Round trips of the wire encoding of BoardProtocol.
+void RunProtocolTests(Context * context);
+/// Allocation order of PlayerSlots.
+void RunPlayerSlotsTests();
+/// Metrics line and trace of BoardProfiler read back as JSON.
+void RunProfilerTests(Context * context);
+
+#endif // _BOARD_TESTS_H_INCLUDED__
@@ -0,0 +1,72 @@
+#include "BoardTests.h"
+#include "BoardGrid.h"
+#include "PlayerSlots.h"
+
+#include <Urho3D/Core/StringUtils.h>
+
+namespace
+{
+    /// The slots only key the connections, they are never dereferenced.
+    Connection * GetConnection(unsigned index)
+    {
+        return reinterpret_cast<Connection*>(static_cast<size_t>(index + 1) * 16);
+    }
+
+    void TestOrder()
+    {
+        PlayerSlots slots;
+        slots.Reset(4);
+        for(unsigned i = 0; i < 4; ++i)
+            Check(slots.Acquire(GetConnection(i)) == i + 1, "slots are not given out in order", "slots, first join");
+        Check(slots.Acquire(GetConnection(4)) == NO_OWNER, "slot over the limit is given out", "slots, full");
+        Check(slots.Acquire(GetConnection(0)) == 1, "connection gets another slot", "slots, second acquire");
+
+        // The leaving player's slot is taken last, the free ones go first
+        slots.Release(GetConnection(1));
+        slots.Release(GetConnection(0));
+        Check(slots.GetNumFree() == 2 && slots.GetNumUsed() == 2, "free and used counts differ", "slots, release");
+        Check(slots.Acquire(GetConnection(5)) == 2, "slots are not recycled in the release order", "slots, rejoin");
+        Check(slots.Acquire(GetConnection(6)) == 1, "slots are not recycled in the release order", "slots, rejoin");
+        Check(slots.GetSlot(GetConnection(1)) == NO_OWNER, "released connection keeps the slot", "slots, release");
+    }
+
+    void TestRecycle()
+    {
+        PlayerSlots slots;
+        slots.Reset(8);
+        for(unsigned i = 0; i < 3; ++i)
+            slots.Acquire(GetConnection(i));
+
+        // Many leaves and joins wrap the ring, a released slot is never given out while other slots are free
+        for(unsigned i = 0; i < 100; ++i)
+        {
+            auto leaving = GetConnection(i);
+            auto slot = slots.GetSlot(leaving);
+            slots.Release(leaving);
+            auto joined = slots.Acquire(GetConnection(i + 3));
+            if(!Check(joined != NO_OWNER && joined != slot, "released slot is given out again while others are free",
+                ToString("slots, recycle %u", i)))
+                return;
+        }
+        Check(slots.GetNumFree() == 5 && slots.GetNumUsed() == 3, "free and used counts differ", "slots, recycle");
+    }
+
+    void TestReserve()
+    {
+        // The slots of the restored board are given out after all the others
+        PlayerSlots slots;
+        slots.Reset(4);
+        slots.Reserve(1);
+        slots.Reserve(3);
+        static const unsigned char order[] = { 2, 4, 1, 3 };
+        for(unsigned i = 0; i < 4; ++i)
+            Check(slots.Acquire(GetConnection(i)) == order[i], "reserved slot is given out early", "slots, reserve");
+    }
+}
+
+void RunPlayerSlotsTests()
+{
+    TestOrder();
+    TestRecycle();
+    TestReserve();
+}
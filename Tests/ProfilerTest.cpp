@@ -0,0 +1,100 @@
+#include "BoardTests.h"
+#include "BoardProfiler.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
+#include <Urho3D/Resource/JSONFile.h>
+
+static const char * METRICS_FILE = "ProfilerTest.jsonl";
+static const char * TRACE_FILE = "ProfilerTest.json";
+/// Time of the timed section, the reported times are at least this.
+static const unsigned SECTION_MS = 5;
+
+namespace
+{
+    /// Return the whole text of the file.
+    String ReadText(Context * context, const char * fileName)
+    {
+        File file(context, fileName);
+        String text;
+        while(!file.IsEof())
+            text += file.ReadLine() + "\n";
+        return text;
+    }
+
+    void CheckMetrics(Context * context)
+    {
+        auto lines = ReadText(context, METRICS_FILE).Split('\n');
+        if(!Check(lines.Size() == 1, "one metrics line is expected", "profiler, metrics"))
+            return;
+
+        // The values after the fractions are read back exactly
+        JSONFile json(context);
+        if(!Check(json.FromString(lines[0]), "metrics line is not JSON", "profiler, metrics"))
+            return;
+        const auto & root = json.GetRoot();
+        Check(root.Get("ticks").GetUInt() == 2 && root.Get("overruns").GetUInt() == 0, "ticks differ", "profiler, metrics");
+        Check(root.Get("tick_ms").Get("max").GetFloat() >= SECTION_MS, "tick time is short", "profiler, metrics");
+        Check(root.Get("claims_ms").Get("max").GetFloat() >= SECTION_MS, "section time is short", "profiler, metrics");
+        Check(root.Get("touches_ms").Get("max").GetFloat() == 0.0f, "untimed section has time", "profiler, metrics");
+        Check(root.Get("touches_per_s").GetFloat() > 2.0f && root.Get("touches_per_s").GetFloat() <= 3.0f,
+            "touches per second differ", "profiler, metrics");
+        Check(root.Get("claims_per_s").GetFloat() > 1.0f && root.Get("rejected_per_s").GetFloat() > 0.5f,
+            "claims per second differ", "profiler, metrics");
+        Check(root.Get("connections").GetUInt() == 1, "connections differ", "profiler, metrics");
+        Check(root.Get("bytes_per_connection_per_s").Get("max").GetFloat() > 50.0f, "bytes differ", "profiler, metrics");
+        Check(root.Get("queue_max").Get("claims").GetUInt() == 7, "queue depth differs", "profiler, metrics");
+    }
+
+    void CheckTrace(Context * context)
+    {
+        JSONFile json(context);
+        if(!Check(json.FromString(ReadText(context, TRACE_FILE)), "trace is not JSON", "profiler, trace"))
+            return;
+
+        // The section of the first tick, then the two ticks
+        const auto & events = json.GetRoot();
+        if(!Check(events.IsArray() && events.Size() == 3, "trace events differ", "profiler, trace"))
+            return;
+        Check(events[0].Get("name").GetString() == "claims" && events[0].Get("dur").GetDouble() >= SECTION_MS * 1000.0,
+            "section event differs", "profiler, trace");
+        Check(events[2].Get("ts").GetDouble() > events[1].Get("ts").GetDouble() + METRICS_INTERVAL * 1000000.0,
+            "tick events differ", "profiler, trace");
+    }
+}
+
+void RunProfilerTests(Context * context)
+{
+    {
+        auto profiler = MakeShared<BoardProfiler>(context);
+        if(!Check(profiler->SetMetricsOutput(METRICS_FILE) && profiler->SetTraceOutput(TRACE_FILE),
+            "outputs can not be opened", "profiler, outputs"))
+            return;
+
+        // One timed tick, the second one after the interval writes the metrics line
+        auto connection = reinterpret_cast<Connection*>(16);
+        profiler->BeginTick();
+        profiler->BeginSection(PROFILE_CLAIMS);
+        Time::Sleep(SECTION_MS);
+        profiler->EndSection(PROFILE_CLAIMS);
+        profiler->AddTouches(3);
+        profiler->AddClaims(2, 1);
+        profiler->AddBytesSent(connection, 100);
+        profiler->SetQueueDepth(QUEUE_CLAIMS, 7);
+        profiler->EndTick(1.0f / 30.0f);
+
+        Time::Sleep(static_cast<unsigned>(METRICS_INTERVAL * 1000.0f));
+        profiler->BeginTick();
+        profiler->EndTick(1.0f / 30.0f);
+    }
+
+    CheckMetrics(context);
+    CheckTrace(context);
+
+    auto fileSystem = context->GetSubsystem<FileSystem>();
+    fileSystem->Delete(METRICS_FILE);
+    fileSystem->Delete(TRACE_FILE);
+}
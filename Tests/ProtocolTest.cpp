@@ -0,0 +1,359 @@
+#include "BoardTests.h"
+#include "BoardGrid.h"
+#include "BoardProtocol.h"
+#include "PlayerSlots.h"
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/IO/MemoryBuffer.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+/// Owner of the cells of the decoding grid the message does not set.
+static const unsigned char UNTOUCHED_OWNER = 0xfe;
+/// Number of the truncated copies of every message checked, spread over its length.
+static const unsigned MAX_TRUNCATIONS = 64;
+
+namespace
+{
+    unsigned random = 1;
+
+    unsigned NextRandom()
+    {
+        // xorshift32, the same cases on every run
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    void FillOwners(BoardGrid & grid, unsigned char owner)
+    {
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+            grid.SetOwner(cell, owner);
+    }
+
+    /// Territories of the square blocks of the cells, the long runs of one owner.
+    void FillBlocks(BoardGrid & grid, int blockSize)
+    {
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+        {
+            auto x = static_cast<int>(cell) % grid.GetWidth() / blockSize;
+            auto y = static_cast<int>(cell) / grid.GetWidth() / blockSize;
+            grid.SetOwner(cell, static_cast<unsigned char>((x * 7 + y * 3) % MAX_PLAYERS + 1));
+        }
+    }
+
+    void FillRandom(BoardGrid & grid)
+    {
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+            grid.SetOwner(cell, static_cast<unsigned char>(NextRandom() % (MAX_PLAYERS + 1)));
+    }
+
+    /// Check that every message shorter than the full one is rejected by the reader.
+    template <class Reader> void CheckTruncated(const VectorBuffer & message, Reader read, const String & test)
+    {
+        // The last byte missing is always checked
+        auto step = Max(message.GetSize() / MAX_TRUNCATIONS, 1u);
+        for(unsigned size = 0; size < message.GetSize(); size += step)
+        {
+            auto truncatedSize = size + step < message.GetSize() ? size : message.GetSize() - 1;
+
+            MemoryBuffer source(message.GetData(), truncatedSize);
+            if(!Check(!read(source), "truncated message is accepted",
+                ToString("%s, %u of %u bytes", test.CString(), truncatedSize, message.GetSize())))
+                return;
+        }
+    }
+
+    void CheckDelta(BoardGrid & grid, BoardGrid & mirror, const PODVector<unsigned> & cells, const String & test)
+    {
+        VectorBuffer message;
+        WriteBoardDelta(message, grid, cells, 17, 12345);
+
+        FillOwners(mirror, UNTOUCHED_OWNER);
+        unsigned sequence = 0;
+        unsigned tick = 0;
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        if(!Check(ReadBoardDelta(source, mirror, sequence, tick), "delta is rejected", test))
+            return;
+        Check(sequence == 17 && tick == 12345, "sequence or tick differ", test);
+        Check(source.IsEof(), "delta is not read to the end", test);
+
+        PODVector<unsigned char> changed(grid.GetNumCells());
+        for(auto & value : changed)
+            value = 0;
+        for(auto cell : cells)
+            changed[cell] = 1;
+
+        unsigned numWrong = 0;
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+        {
+            if(mirror.GetOwner(cell) != (changed[cell] ? grid.GetOwner(cell) : UNTOUCHED_OWNER))
+                ++numWrong;
+        }
+        Check(!numWrong, "decoded owners differ", test);
+
+        CheckTruncated(message, [&mirror](MemoryBuffer & truncated)
+        {
+            unsigned sequence, tick;
+            return ReadBoardDelta(truncated, mirror, sequence, tick);
+        }, test);
+    }
+
+    /// Return the owner bit width byte of the chunks message.
+    unsigned char GetChunksOwnerBits(const VectorBuffer & message, const PODVector<unsigned> & chunks)
+    {
+        auto position = GetVLESize(chunks.Size());
+        for(auto chunk : chunks)
+            position += GetVLESize(chunk);
+        return position < message.GetSize() ? message.GetData()[position] : 0;
+    }
+
+    void CheckChunks(BoardGrid & grid, BoardGrid & mirror, const PODVector<unsigned> & chunks, bool runs, const String & test)
+    {
+        VectorBuffer message;
+        WriteBoardChunks(message, grid, chunks);
+        Check(((GetChunksOwnerBits(message, chunks) & OWNER_RUNS_FLAG) != 0) == runs,
+            runs ? "owners are not run-length encoded" : "owners are not packed", test);
+
+        FillOwners(mirror, UNTOUCHED_OWNER);
+        PODVector<unsigned> decoded;
+        decoded.Push(M_MAX_UNSIGNED);
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        if(!Check(ReadBoardChunks(source, mirror, decoded), "chunks are rejected", test))
+            return;
+        Check(source.IsEof(), "chunks are not read to the end", test);
+        Check(decoded.Size() == chunks.Size() + 1 && decoded[0] == M_MAX_UNSIGNED, "chunk indices are not appended", test);
+        for(unsigned i = 0; i < chunks.Size() && i + 1 < decoded.Size(); ++i)
+            Check(decoded[i + 1] == chunks[i], "chunk indices differ", test);
+
+        PODVector<unsigned char> sent(grid.GetNumCells());
+        for(auto & value : sent)
+            value = 0;
+        PODVector<unsigned> cells;
+        for(auto chunk : chunks)
+            grid.GetChunkCells(grid.GetChunkCoords(chunk), cells);
+        for(auto cell : cells)
+            sent[cell] = 1;
+
+        unsigned numWrong = 0;
+        for(unsigned cell = 0; cell < grid.GetNumCells(); ++cell)
+        {
+            if(mirror.GetOwner(cell) != (sent[cell] ? grid.GetOwner(cell) : UNTOUCHED_OWNER))
+                ++numWrong;
+        }
+        Check(!numWrong, "decoded owners differ", test);
+
+        CheckTruncated(message, [&mirror](MemoryBuffer & truncated)
+        {
+            PODVector<unsigned> chunks;
+            return ReadBoardChunks(truncated, mirror, chunks);
+        }, test);
+    }
+
+    void CheckTouches(const PODVector<TouchData> & touches, const String & test)
+    {
+        VectorBuffer message;
+        WriteTouchBatch(message, touches);
+
+        // The reader appends to the touches already queued
+        TouchData queued;
+        queued.cell_ = queued.sequence_ = queued.time_ = 7;
+        PODVector<TouchData> decoded;
+        decoded.Push(queued);
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        if(!Check(ReadTouchBatch(source, decoded), "touch batch is rejected", test))
+            return;
+        Check(source.IsEof(), "touch batch is not read to the end", test);
+        if(!Check(decoded.Size() == touches.Size() + 1, "number of the touches differs", test))
+            return;
+
+        Check(decoded[0].cell_ == 7 && decoded[0].sequence_ == 7 && decoded[0].time_ == 7, "queued touch is changed", test);
+        for(unsigned i = 0; i < touches.Size(); ++i)
+        {
+            auto & touch = decoded[i + 1];
+            Check(touch.cell_ == touches[i].cell_ && touch.sequence_ == touches[i].sequence_ && touch.time_ == touches[i].time_,
+                "decoded touch differs", ToString("%s, touch %u", test.CString(), i));
+        }
+
+        CheckTruncated(message, [](MemoryBuffer & truncated)
+        {
+            PODVector<TouchData> touches;
+            return ReadTouchBatch(truncated, touches);
+        }, test);
+    }
+
+    void TestDeltas(Context * context)
+    {
+        static const int sizes[] = { 1, 20, 1024 };
+        for(auto size : sizes)
+        {
+            auto grid = MakeShared<BoardGrid>(context);
+            auto mirror = MakeShared<BoardGrid>(context);
+            grid->SetSize(size, size);
+            mirror->SetSize(size, size);
+            auto last = grid->GetNumCells() - 1;
+            PODVector<unsigned> cells;
+
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, empty", size));
+
+            FillRandom(*grid);
+            cells.Push(last);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, last cell", size));
+
+            // The first run starts at the cell 0, the gap to the last cell takes the longest VLE
+            cells.Clear();
+            cells.Push(0);
+            if(last)
+                cells.Push(last);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, long gap", size));
+
+            // The runs of one owner and the neighbour cells of different owners
+            FillBlocks(*grid, 4);
+            cells.Clear();
+            for(unsigned cell = 0; cell <= last; cell += 1 + NextRandom() % 3)
+                cells.Push(cell);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, runs", size));
+
+            FillOwners(*grid, MAX_PLAYERS);
+            cells.Clear();
+            for(unsigned cell = 0; cell <= last; ++cell)
+                cells.Push(cell);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, full board of one owner", size));
+
+            FillRandom(*grid);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, full board", size));
+
+            FillOwners(*grid, NO_OWNER);
+            CheckDelta(*grid, *mirror, cells, ToString("delta %d, full board of free cells", size));
+        }
+
+        // A run past the end of a smaller board
+        auto grid = MakeShared<BoardGrid>(context);
+        auto small = MakeShared<BoardGrid>(context);
+        grid->SetSize(64, 64);
+        small->SetSize(8, 8);
+        FillOwners(*grid, 1);
+        PODVector<unsigned> cells;
+        cells.Push(grid->GetNumCells() - 2);
+        cells.Push(grid->GetNumCells() - 1);
+        VectorBuffer message;
+        WriteBoardDelta(message, *grid, cells, 0, 0);
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        unsigned sequence, tick;
+        Check(!ReadBoardDelta(source, *small, sequence, tick), "run past the board is accepted", "delta, smaller board");
+    }
+
+    void TestChunks(Context * context)
+    {
+        // 20 is not a multiple of the chunk size, the edge chunks are partial
+        static const int sizes[] = { 1, 20, 256 };
+        for(auto size : sizes)
+        {
+            auto grid = MakeShared<BoardGrid>(context);
+            auto mirror = MakeShared<BoardGrid>(context);
+            grid->SetSize(size, size);
+            mirror->SetSize(size, size);
+            auto numChunks = grid->GetNumChunks();
+            auto lastChunk = static_cast<unsigned>(numChunks.x_ * numChunks.y_) - 1;
+            PODVector<unsigned> chunks;
+
+            CheckChunks(*grid, *mirror, chunks, false, ToString("chunks %d, empty", size));
+
+            for(unsigned chunk = 0; chunk <= lastChunk; ++chunk)
+                chunks.Push(chunk);
+            CheckChunks(*grid, *mirror, chunks, size > 1, ToString("chunks %d, free board", size));
+
+            FillBlocks(*grid, 8);
+            CheckChunks(*grid, *mirror, chunks, size > 1, ToString("chunks %d, territories", size));
+
+            // The random owners are shorter packed
+            FillRandom(*grid);
+            CheckChunks(*grid, *mirror, chunks, false, ToString("chunks %d, random owners", size));
+
+            // The view order, the last chunk first
+            chunks.Clear();
+            for(unsigned chunk = lastChunk + 1; chunk-- > 0;)
+                chunks.Push(chunk);
+            FillBlocks(*grid, 8);
+            CheckChunks(*grid, *mirror, chunks, size > 1, ToString("chunks %d, reversed", size));
+        }
+
+        auto grid = MakeShared<BoardGrid>(context);
+        grid->SetSize(20, 20);
+        VectorBuffer message;
+        message.WriteVLE(1);
+        message.WriteVLE(4);
+        message.WriteUByte(1);
+        MemoryBuffer source(message.GetData(), message.GetSize());
+        PODVector<unsigned> chunks;
+        Check(!ReadBoardChunks(source, *grid, chunks), "chunk past the board is accepted", "chunks, bad index");
+    }
+
+    void TestTouches()
+    {
+        PODVector<TouchData> touches;
+        CheckTouches(touches, "touches, empty");
+
+        TouchData touch;
+        touch.cell_ = 1000000;
+        touch.sequence_ = 100;
+        touch.time_ = 5000;
+        touches.Push(touch);
+        CheckTouches(touches, "touches, single");
+
+        // The cells go back and forth, the deltas are negative and long
+        static const unsigned cells[] = { 0, 1048575, 3, 2, 1, 0, 500, 437, 1048000, 17 };
+        touches.Clear();
+        for(unsigned i = 0; i < sizeof(cells) / sizeof(cells[0]); ++i)
+        {
+            touch.cell_ = cells[i];
+            touch.sequence_ = 100000000u + i;
+            touch.time_ = 0xffffff00u + i * 100;
+            touches.Push(touch);
+        }
+        CheckTouches(touches, "touches, negative deltas");
+
+        // The player paints around the previous touch
+        touches.Clear();
+        auto cell = 512u * 1024u + 512u;
+        for(unsigned i = 0; i < 200; ++i)
+        {
+            cell += static_cast<unsigned>(static_cast<int>(NextRandom() % 7) - 3 + (static_cast<int>(NextRandom() % 7) - 3) * 1024);
+            touch.cell_ = cell;
+            touch.sequence_ = i;
+            touch.time_ = 1000 + i * 33;
+            touches.Push(touch);
+        }
+        CheckTouches(touches, "touches, nearby");
+    }
+
+    void TestViewRegions()
+    {
+        // The largest rectangle is 29 bits, the VLE limit
+        static const IntRect regions[] = { IntRect(0, 0, 0, 0), IntRect(3, 5, 7, 9), IntRect(100, 2000, 300000, 0x1fffffff) };
+        for(const auto & region : regions)
+        {
+            auto test = ToString("view region %d, %d, %d, %d", region.left_, region.top_, region.right_, region.bottom_);
+            VectorBuffer message;
+            WriteViewRegion(message, region);
+
+            MemoryBuffer source(message.GetData(), message.GetSize());
+            IntRect read;
+            Check(ReadViewRegion(source, read) && read == region, "region differs", test);
+            CheckTruncated(message, [](MemoryBuffer & truncated)
+            {
+                IntRect read;
+                return ReadViewRegion(truncated, read);
+            }, test);
+        }
+    }
+}
+
+void RunProtocolTests(Context * context)
+{
+    TestDeltas(context);
+    TestChunks(context);
+    TestTouches();
+    TestViewRegions();
+}
@@ -1,15 +1,18 @@
 #include "TouchClient.h"
 #include "TouchEvent.h"
+#include "BoardClient.h"
 
 #include <Urho3D/Core/Context.h>
-#include <Urho3D/Scene/Node.h>
-#include <Urho3D/Input/Controls.h>
+#include <Urho3D/Core/Timer.h>
 #include <Urho3D/Network/Connection.h>
 #include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
 #include <Urho3D/IO/Log.h>
+#include <Urho3D/Scene/Scene.h>
 
 TouchClient::TouchClient(Context * context)
-    : LogicComponent(context)
+    : Component(context)
+    , sequence_(0)
 {}
 
 void TouchClient::RegisterObject(Context * context)
@@ -17,18 +20,45 @@ void TouchClient::RegisterObject(Context * context)
     context->RegisterFactory<TouchClient>();
 }
 
-void TouchClient::OnNodeSet(Node * node)
+void TouchClient::OnSceneSet(Scene * scene)
 {
-    if(node)
+    if(scene)
     {
-        SubscribeToEvent(node, E_TOUCHOBJECT, [this](StringHash, VariantMap &)
-        {
-            if(auto connection = GetSubsystem<Network>()->GetServerConnection())
-            {
-                Controls controls;
-                controls.Set(GetNode()->GetID(), true);
-                connection->SetControls(controls);
-            }
-        });
+        SubscribeToEvent(E_TOUCHOBJECT, URHO3D_HANDLER(TouchClient, HandleTouchObject));
+        SubscribeToEvent(E_NETWORKUPDATE, URHO3D_HANDLER(TouchClient, HandleNetworkUpdate));
     }
+    else
+        UnsubscribeFromAllEvents();
+}
+
+void TouchClient::HandleTouchObject(StringHash eventType, VariantMap & eventData)
+{
+    using namespace TouchObject;
+
+    if(!GetSubsystem<Network>()->GetServerConnection())
+        return;
+
+    TouchData touch;
+    touch.cell_ = eventData[P_CELL].GetUInt();
+    touch.sequence_ = sequence_++;
+    touch.time_ = Time::GetSystemTime();
+    touches_.Push(touch);
+
+    // Show the claim at once, the server confirms or rolls it back later
+    if(auto board = GetScene()->GetComponent<BoardClient>())
+        board->Predict(touch.cell_, touch.sequence_);
+}
+
+void TouchClient::HandleNetworkUpdate(StringHash eventType, VariantMap & eventData)
+{
+    if(touches_.Empty())
+        return;
+
+    if(auto connection = GetSubsystem<Network>()->GetServerConnection())
+    {
+        message_.Clear();
+        WriteTouchBatch(message_, touches_);
+        connection->SendMessage(MSG_TOUCH_BATCH, true, true, message_);
+    }
+    touches_.Clear();
 }
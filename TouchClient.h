@@ -1,19 +1,23 @@
 #ifndef _TOUCH_CLIENT_H_INCLUDED__
 #define _TOUCH_CLIENT_H_INCLUDED__
 
-#include <Urho3D/Scene/LogicComponent.h>
+#include <Urho3D/Scene/Component.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "BoardProtocol.h"
 
 using namespace Urho3D;
 
 namespace Urho3D
 {
     class Context;
-    class Node;
+    class Scene;
 }
 
-class TouchClient : public LogicComponent
+/// Collects the touches from TouchDispatcher and sends them to the server in one batch per network update.
+class TouchClient : public Component
 {
-    URHO3D_OBJECT(TouchClient, LogicComponent);
+    URHO3D_OBJECT(TouchClient, Component);
 
 public:
 
@@ -22,7 +26,20 @@ public:
 
 protected:
 
-    void OnNodeSet(Node * node);
+    void OnSceneSet(Scene * scene);
+
+private:
+
+    void HandleTouchObject(StringHash eventType, VariantMap & eventData);
+    void HandleNetworkUpdate(StringHash eventType, VariantMap & eventData);
+
+private:
+
+    /// Touches not sent yet.
+    PODVector<TouchData> touches_;
+    /// Sequence number of the next touch.
+    unsigned sequence_;
+    VectorBuffer message_;
 };
 
 #endif // _TOUCH_CLIENT_H_INCLUDED__
@@ -1,5 +1,7 @@
 #include "TouchDispatcher.h"
 #include "TouchEvent.h"
+#include "BoardGrid.h"
+#include "BoardRenderer.h"
 
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Graphics/Renderer.h>
@@ -36,25 +38,53 @@ void TouchDispatcher::OnSceneSet(Scene * scene)
             auto input = GetSubsystem<Input>();
             if(input->GetMouseButtonPress(MOUSEB_LEFT))
             {
-                if(auto node = Raycast(distance_, GetSubsystem<UI>()->GetCursorPosition()))
-                    node->SendEvent(E_TOUCHOBJECT);
+                unsigned cell = 0;
+                if(Raycast(distance_, GetSubsystem<UI>()->GetCursorPosition(), cell))
+                {
+                    using namespace TouchObject;
+                    SendEvent(E_TOUCHOBJECT, P_CELL, cell);
+                }
             }
         });
     }
 }
 
-Node * TouchDispatcher::Raycast(float distance, IntVector2 origin)
+bool TouchDispatcher::Raycast(float distance, IntVector2 origin, unsigned & cell)
 {
     if(auto viewport = GetSubsystem<Renderer>()->GetViewport(0))
     {
         auto ray = viewport->GetScreenRay(origin.x_, origin.y_);
 
+        // The board is a regular grid, map the ray to the cell directly
+        auto grid = scene_->GetComponent<BoardGrid>();
+        auto renderer = scene_->GetComponent<BoardRenderer>(true);
+        if(grid && renderer)
+        {
+            const auto & transform = renderer->GetNode()->GetWorldTransform();
+            auto localRay = ray.Transformed(transform.Inverse());
+
+            float hitDistance = 0.0f;
+            if(grid->Raycast(localRay, cell, hitDistance))
+            {
+                if(cell == M_MAX_UNSIGNED)
+                    return false;
+                auto position = transform * (localRay.origin_ + localRay.direction_ * hitDistance);
+                return (position - ray.origin_).Length() <= distance;
+            }
+        }
+
+        // Ray is almost parallel to the board, fall back to the octree query
         PODVector<RayQueryResult> results;
         RayOctreeQuery query(results, ray, RAY_TRIANGLE, distance, DRAWABLE_GEOMETRY);
         scene_->GetComponent<Octree>()->RaycastSingle(query);
 
-        return results.Size() ? results[0].node_ : nullptr;
+        // BoardRenderer reports the cell as the sub object
+        if(results.Size() && results[0].drawable_->IsInstanceOf<BoardRenderer>())
+        {
+            cell = results[0].subObject_;
+            return true;
+        }
     }
 
-    return nullptr;
+    return false;
 }
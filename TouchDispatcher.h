@@ -29,7 +29,8 @@ protected:
 
 private:
 
-    Node * Raycast(float distance, IntVector2 origin);
+    /// Return the board cell under the screen position.
+    bool Raycast(float distance, IntVector2 origin, unsigned & cell);
 
 private:
 
@@ -4,12 +4,17 @@
 #include <Urho3D/Core/Object.h>
 
 URHO3D_EVENT(E_TOUCHOBJECT, TouchObject)
-{}
+{
+    URHO3D_PARAM(P_CELL, Cell);
+}
 
 URHO3D_EVENT(E_TOUCHREACTION, TouchReaction)
 {
-    URHO3D_PARAM(P_NODE, Node);
+    URHO3D_PARAM(P_CELL, Cell);
     URHO3D_PARAM(P_CONNECTION, Connection);
+    URHO3D_PARAM(P_SEQUENCE, Sequence);
+    URHO3D_PARAM(P_TIME, Time);
+    URHO3D_PARAM(P_TICK, Tick);
 }
 
 #endif // _TOUCH_EVENT_H_INCLUDED__
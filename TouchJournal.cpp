@@ -0,0 +1,117 @@
+#include "TouchJournal.h"
+
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/Log.h>
+
+namespace
+{
+    const char JOURNAL_MAGIC[] = "BRDJ";
+}
+
+TouchJournal::TouchJournal()
+    : lastTick_(0)
+{}
+
+TouchJournal::~TouchJournal()
+{
+    Close();
+}
+
+bool TouchJournal::Create(Context * context, const String & fileName, int width, int height)
+{
+    Close();
+
+    file_ = MakeShared<File>(context, fileName, FILE_WRITE);
+    if(!file_->IsOpen())
+    {
+        URHO3D_LOGERRORF("Can not create the touch journal %s", fileName.CString());
+        file_.Reset();
+        return false;
+    }
+
+    file_->WriteFileID(JOURNAL_MAGIC);
+    file_->WriteUInt(JOURNAL_VERSION);
+    file_->WriteInt(width);
+    file_->WriteInt(height);
+    buffer_.Clear();
+    lastTick_ = 0;
+    return true;
+}
+
+void TouchJournal::Close()
+{
+    if(file_)
+    {
+        Flush();
+        file_->Close();
+        file_.Reset();
+    }
+}
+
+void TouchJournal::Write(unsigned tick, unsigned char slot, unsigned cell, unsigned sequence)
+{
+    if(!file_)
+        return;
+
+    // Most of the touches share the tick with the previous one, the delta takes a byte
+    buffer_.WriteVLE(tick - lastTick_);
+    buffer_.WriteUByte(slot);
+    buffer_.WriteVLE(cell);
+    buffer_.WriteVLE(sequence);
+    lastTick_ = tick;
+
+    if(buffer_.GetSize() >= JOURNAL_BUFFER_SIZE)
+        Flush();
+}
+
+void TouchJournal::Flush()
+{
+    if(file_ && buffer_.GetSize())
+    {
+        file_->Write(buffer_.GetData(), buffer_.GetSize());
+        file_->Flush();
+        buffer_.Clear();
+    }
+}
+
+TouchJournalReader::TouchJournalReader()
+    : width_(0)
+    , height_(0)
+    , lastTick_(0)
+{}
+
+bool TouchJournalReader::Open(Context * context, const String & fileName)
+{
+    file_ = MakeShared<File>(context, fileName, FILE_READ);
+    if(!file_->IsOpen() || file_->ReadFileID() != JOURNAL_MAGIC || file_->ReadUInt() != JOURNAL_VERSION)
+    {
+        URHO3D_LOGERRORF("%s is not a touch journal of version %u", fileName.CString(), JOURNAL_VERSION);
+        file_.Reset();
+        return false;
+    }
+
+    width_ = file_->ReadInt();
+    height_ = file_->ReadInt();
+    lastTick_ = 0;
+    return true;
+}
+
+bool TouchJournalReader::Read(JournalRecord & record)
+{
+    // A record cut by the crash of the server ends the journal
+    if(!file_ || file_->IsEof())
+        return false;
+    record.tick_ = lastTick_ + file_->ReadVLE();
+    if(file_->IsEof())
+        return false;
+    record.slot_ = file_->ReadUByte();
+    if(file_->IsEof())
+        return false;
+    record.cell_ = file_->ReadVLE();
+    if(file_->IsEof())
+        return false;
+    record.sequence_ = file_->ReadVLE();
+
+    lastTick_ = record.tick_;
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef _TOUCH_JOURNAL_H_INCLUDED__
+#define _TOUCH_JOURNAL_H_INCLUDED__
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+using namespace Urho3D;
+
+namespace Urho3D
+{
+    class Context;
+    class File;
+}
+
+/// Version of the journal layout.
+static const unsigned JOURNAL_VERSION = 1;
+/// Size of the buffered records written to the file at once.
+static const unsigned JOURNAL_BUFFER_SIZE = 64 * 1024;
+
+/// Accepted touch as recorded in the journal.
+struct JournalRecord
+{
+    /// Server frame the touch was dispatched in.
+    unsigned tick_;
+    /// Player slot of the connection.
+    unsigned char slot_;
+    unsigned cell_;
+    /// Touch sequence of the connection.
+    unsigned sequence_;
+};
+
+/// Append-only binary journal of the touches dispatched to the claim pipeline.
+/// Layout: magic, version, board width and height, then per touch VLE tick delta, slot byte, VLE cell, VLE sequence.
+/// A record with the NO_OWNER slot marks the start of a new round, its sequence is the round number.
+class TouchJournal
+{
+public:
+
+    TouchJournal();
+    ~TouchJournal();
+
+    /// Create the journal for the board, the records follow the header.
+    bool Create(Context * context, const String & fileName, int width, int height);
+    /// Flush the buffered records and close the file.
+    void Close();
+    bool IsOpen() const { return file_.NotNull(); }
+
+    /// Buffer the record, the buffer goes to the file when full.
+    void Write(unsigned tick, unsigned char slot, unsigned cell, unsigned sequence);
+    /// Write the buffered records to the file.
+    void Flush();
+
+private:
+
+    SharedPtr<File> file_;
+    VectorBuffer buffer_;
+    unsigned lastTick_;
+};
+
+/// Reads the journal written by TouchJournal.
+class TouchJournalReader
+{
+public:
+
+    TouchJournalReader();
+
+    /// Open the journal and read the header.
+    bool Open(Context * context, const String & fileName);
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+
+    /// Read the next record. Return false at the end of the journal.
+    bool Read(JournalRecord & record);
+
+private:
+
+    SharedPtr<File> file_;
+    int width_;
+    int height_;
+    unsigned lastTick_;
+};
+
+#endif // _TOUCH_JOURNAL_H_INCLUDED__
@@ -0,0 +1,54 @@
+#include "TouchQueue.h"
+
+#include <Urho3D/Math/MathDefs.h>
+
+TouchQueue::TouchQueue(unsigned capacity)
+    : mask_(NextPowerOfTwo(Max(capacity, 1u)) - 1)
+    , head_(0)
+    , tail_(0)
+{
+    items_ = new TouchData[mask_ + 1];
+}
+
+TouchQueue::TouchQueue(const TouchQueue & queue)
+    : mask_(queue.mask_)
+    , head_(0)
+    , tail_(0)
+{
+    items_ = new TouchData[mask_ + 1];
+    *this = queue;
+}
+
+TouchQueue & TouchQueue::operator =(const TouchQueue & queue)
+{
+    if(&queue == this)
+        return *this;
+
+    // The storage is never shared, the connection states are copied by value in the map
+    if(mask_ != queue.mask_)
+    {
+        mask_ = queue.mask_;
+        items_ = new TouchData[mask_ + 1];
+    }
+
+    for(auto i = queue.head_; i != queue.tail_; ++i)
+        items_[i & mask_] = queue.items_[i & mask_];
+    head_ = queue.head_;
+    tail_ = queue.tail_;
+    return *this;
+}
+
+bool TouchQueue::Push(const TouchData & touch)
+{
+    if(tail_ - head_ > mask_)
+        return false;
+
+    items_[tail_++ & mask_] = touch;
+    return true;
+}
+
+void TouchQueue::Drain(PODVector<TouchData> & touches)
+{
+    for(; head_ != tail_; ++head_)
+        touches.Push(items_[head_ & mask_]);
+}
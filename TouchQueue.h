@@ -0,0 +1,44 @@
+#ifndef _TOUCH_QUEUE_H_INCLUDED__
+#define _TOUCH_QUEUE_H_INCLUDED__
+
+#include <Urho3D/Container/ArrayPtr.h>
+
+#include "BoardProtocol.h"
+
+using namespace Urho3D;
+
+/// Bounded ring of the touches of one connection, pushed by the message handler and drained by the tick.
+/// The storage is allocated once with the connection, pushing and draining never allocate and a full ring drops
+/// the pushed touch. Both sides run on the main thread, Urho3D reads the network messages in Network::Update,
+/// so the ring is not synchronized.
+/// The indices only grow, the capacity is a power of two and the slot is the index masked.
+class TouchQueue
+{
+public:
+
+    /// Create the queue for at least the capacity touches.
+    explicit TouchQueue(unsigned capacity);
+    /// Copy the queued touches into own storage.
+    TouchQueue(const TouchQueue & queue);
+    TouchQueue & operator =(const TouchQueue & queue);
+
+    /// Push the touch. Return false if the queue is full.
+    bool Push(const TouchData & touch);
+    /// Append all the queued touches to the vector and remove them.
+    void Drain(PODVector<TouchData> & touches);
+
+    unsigned GetSize() const { return tail_ - head_; }
+    bool IsEmpty() const { return head_ == tail_; }
+    unsigned GetCapacity() const { return mask_ + 1; }
+
+private:
+
+    SharedArrayPtr<TouchData> items_;
+    unsigned mask_;
+    /// Index of the next touch to drain.
+    unsigned head_;
+    /// Index of the next touch to push.
+    unsigned tail_;
+};
+
+#endif // _TOUCH_QUEUE_H_INCLUDED__
@@ -1,16 +1,20 @@
 #include "TouchServer.h"
+#include "BoardGrid.h"
+#include "BoardProfiler.h"
 #include "TouchEvent.h"
 
 #include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/IO/MemoryBuffer.h>
 #include <Urho3D/Scene/Scene.h>
-#include <Urho3D/Scene/SceneEvents.h>
-#include <Urho3D/Scene/Node.h>
-#include <Urho3D/Input/Controls.h>
 #include <Urho3D/Network/Connection.h>
-#include <Urho3D/Network/Network.h>
+#include <Urho3D/Network/NetworkEvents.h>
 
 TouchServer::TouchServer(Context * context)
     : Component(context)
+    , touchRate_(TOUCH_RATE)
+    , touchBurst_(TOUCH_BURST)
 {}
 
 void TouchServer::RegisterObject(Context * context)
@@ -18,33 +22,213 @@ void TouchServer::RegisterObject(Context * context)
     context->RegisterFactory<TouchServer>();
 }
 
+void TouchServer::SetRateLimit(float rate, float burst)
+{
+    touchRate_ = Max(rate, 0.0f);
+    touchBurst_ = Max(burst, 1.0f);
+}
+
+const TouchStats * TouchServer::GetStats(Connection * connection) const
+{
+    auto it = inputs_.Find(connection);
+    return it != inputs_.End() ? &it->second_.stats_ : nullptr;
+}
+
 void TouchServer::OnSceneSet(Scene * scene)
 {
     if(scene)
     {
         scene_ = GetScene();
-        SubscribeToEvent(E_SCENEUPDATE, [this](StringHash, VariantMap &)
-        {
-            auto network = GetSubsystem<Network>();
-            if(network->IsServerRunning())
-            {
-                for(auto & connection : network->GetClientConnections())
-                    ProcessConnection(connection);
-            }
-        });
+        SubscribeToEvent(E_NETWORKMESSAGE, URHO3D_HANDLER(TouchServer, HandleNetworkMessage));
+        SubscribeToEvent(E_CLIENTDISCONNECTED, URHO3D_HANDLER(TouchServer, HandleClientDisconnected));
+    }
+    else
+    {
+        UnsubscribeFromAllEvents();
+        inputs_.Clear();
+        pending_.Clear();
+        acks_.Clear();
+    }
+}
+
+void TouchServer::HandleNetworkMessage(StringHash eventType, VariantMap & eventData)
+{
+    using namespace NetworkMessage;
+
+    if(eventData[P_MESSAGEID].GetInt() != MSG_TOUCH_BATCH)
+        return;
+
+    ProfileBlock block(GetSubsystem<BoardProfiler>(), PROFILE_TOUCHES);
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    if(connection->GetScene() != scene_)
+        return;
+
+    auto & input = inputs_[connection];
+    MemoryBuffer message(eventData[P_DATA].GetBuffer());
+    batch_.Clear();
+    if(!ReadTouchBatch(message, batch_))
+        URHO3D_LOGWARNINGF("Malformed touch batch from %s", connection->ToString().CString());
+
+    // The queue bounds a flooding client, the touches over it are acknowledged with the rest
+    unsigned numQueued = 0;
+    while(numQueued < batch_.Size() && input.touches_.Push(batch_[numQueued]))
+        ++numQueued;
+
+    if(numQueued < batch_.Size())
+    {
+        auto numDropped = batch_.Size() - numQueued;
+        input.skipSequence_ = Max(input.skipSequence_, batch_.Back().sequence_ + 1);
+        input.stats_.overflow_ += numDropped;
+        totalStats_.overflow_ += numDropped;
+        if(auto profiler = GetSubsystem<BoardProfiler>())
+            profiler->AddDroppedTouches(numDropped);
+    }
+
+    if(!input.pending_ && !input.touches_.IsEmpty())
+    {
+        input.pending_ = true;
+        pending_.Push(connection);
     }
 }
 
-void TouchServer::ProcessConnection(Connection * connection)
+void TouchServer::HandleClientDisconnected(StringHash eventType, VariantMap & eventData)
+{
+    using namespace ClientDisconnected;
+
+    auto connection = static_cast<Connection*>(eventData[P_CONNECTION].GetPtr());
+    inputs_.Erase(connection);
+    pending_.Remove(connection);
+    acks_.Remove(connection);
+}
+
+void TouchServer::ProcessTouches(unsigned tick)
 {
-    if(auto objectID = connection->GetControls().buttons_)
+    if(pending_.Empty())
+        return;
+
+    auto profiler = GetSubsystem<BoardProfiler>();
+    ProfileBlock block(profiler, PROFILE_TOUCHES);
+    if(profiler)
     {
-        if(auto object = scene_->GetNode(objectID))
+        unsigned numQueued = 0;
+        for(auto connection : pending_)
+            numQueued += inputs_[connection].touches_.GetSize();
+        profiler->SetQueueDepth(QUEUE_TOUCHES, numQueued);
+    }
+
+    // Reactions may disconnect clients, so take the list first and look up every connection again
+    PODVector<Connection*> pending;
+    pending.Swap(pending_);
+    for(auto connection : pending)
+    {
+        auto it = inputs_.Find(connection);
+        if(it == inputs_.End())
+            continue;
+
+        auto & input = it->second_;
+        input.pending_ = false;
+        touches_.Clear();
+        input.touches_.Drain(touches_);
+
+        if(!input.ackPending_)
+        {
+            input.ackPending_ = true;
+            acks_.Push(connection);
+        }
+
+        // Refill the bucket for the time since the last dispatch
+        auto now = GetSubsystem<Time>()->GetElapsedTime();
+        if(input.lastRefill_ >= 0.0f)
+            input.tokens_ = Min(input.tokens_ + (now - input.lastRefill_) * touchRate_, touchBurst_);
+        input.lastRefill_ = now;
+
+        auto grid = scene_->GetComponent<BoardGrid>();
+        auto & stats = input.stats_;
+        auto numDropped = stats.GetNumDropped();
+        cells_.Clear();
+
+        auto & nextSequence = input.nextSequence_;
+        for(auto & touch : touches_)
         {
+            // Every touch is consumed exactly once
+            if(touch.sequence_ < nextSequence)
+                continue;
+            nextSequence = touch.sequence_ + 1;
+
+            // Coalesce the touches which can not win before they cost an event and a claim
+            if(cells_.Contains(touch.cell_))
+            {
+                ++stats.duplicates_;
+                ++totalStats_.duplicates_;
+                continue;
+            }
+            cells_.Insert(touch.cell_);
+
+            if(grid && grid->GetBusy(touch.cell_))
+            {
+                ++stats.owned_;
+                ++totalStats_.owned_;
+                continue;
+            }
+
+            if(input.tokens_ < 1.0f)
+            {
+                ++stats.rateLimited_;
+                ++totalStats_.rateLimited_;
+                continue;
+            }
+            input.tokens_ -= 1.0f;
+
+            ++stats.accepted_;
+            ++totalStats_.accepted_;
+            if(profiler)
+                profiler->AddTouches(1);
+
             using namespace TouchReaction;
             SendEvent(E_TOUCHREACTION,
-                P_NODE, object,
-                P_CONNECTION, static_cast<Connection*>(connection));
+                P_CELL, touch.cell_,
+                P_CONNECTION, connection,
+                P_SEQUENCE, touch.sequence_,
+                P_TIME, touch.time_,
+                P_TICK, tick);
+
+            // The connection was dropped by the reaction
+            if(!inputs_.Contains(connection))
+                break;
         }
+
+        it = inputs_.Find(connection);
+        if(it != inputs_.End())
+        {
+            it->second_.nextSequence_ = Max(it->second_.nextSequence_, it->second_.skipSequence_);
+            if(profiler)
+                profiler->AddDroppedTouches(it->second_.stats_.GetNumDropped() - numDropped);
+        }
+    }
+}
+
+void TouchServer::SendAcks(unsigned tick)
+{
+    if(acks_.Empty())
+        return;
+
+    auto profiler = GetSubsystem<BoardProfiler>();
+    ProfileBlock block(profiler, PROFILE_REPLICATION);
+
+    for(auto connection : acks_)
+    {
+        auto it = inputs_.Find(connection);
+        if(it == inputs_.End())
+            continue;
+
+        it->second_.ackPending_ = false;
+        message_.Clear();
+        message_.WriteVLE(it->second_.nextSequence_);
+        message_.WriteVLE(tick);
+        connection->SendMessage(MSG_TOUCH_ACK, true, true, message_);
+        if(profiler)
+            profiler->AddBytesSent(connection, message_.GetSize());
     }
+    acks_.Clear();
 }
@@ -2,6 +2,11 @@
 #define _TOUCH_SERVER_H_INCLUDED__
 
 #include <Urho3D/Scene/Component.h>
+#include <Urho3D/Container/HashSet.h>
+#include <Urho3D/IO/VectorBuffer.h>
+
+#include "BoardProtocol.h"
+#include "TouchQueue.h"
 
 using namespace Urho3D;
 
@@ -10,9 +15,47 @@ namespace Urho3D
     class Context;
     class Node;
     class Scene;
-    class connection;
+    class Connection;
 }
 
+/// Default sustained touch rate of a connection, touches per second.
+static const float TOUCH_RATE = 20.0f;
+/// Default number of touches a connection may send at once above the sustained rate.
+static const float TOUCH_BURST = 40.0f;
+/// Maximum number of the touches queued by a connection between the updates, the rest are dropped on arrival.
+static const unsigned MAX_QUEUED_TOUCHES = 256;
+
+/// Counters of the touches a connection sent.
+struct TouchStats
+{
+    TouchStats()
+        : accepted_(0)
+        , duplicates_(0)
+        , owned_(0)
+        , rateLimited_(0)
+        , overflow_(0)
+    {}
+
+    unsigned GetNumDropped() const { return duplicates_ + owned_ + rateLimited_ + overflow_; }
+
+    /// Touches dispatched to E_TOUCHREACTION.
+    unsigned accepted_;
+    /// Touches of a cell touched earlier in the same update.
+    unsigned duplicates_;
+    /// Touches of a cell that already has an owner.
+    unsigned owned_;
+    /// Touches over the token bucket limit.
+    unsigned rateLimited_;
+    /// Touches over MAX_QUEUED_TOUCHES.
+    unsigned overflow_;
+};
+
+/// Queues the touches of every connection when the batches arrive and dispatches them once per server tick.
+/// The queue of a connection is a preallocated ring: the batch handler produces, the tick consumes.
+/// Both run on the main thread, as Urho3D dispatches the network messages from Network::Update.
+/// Every connection has a token bucket of TOUCH_RATE per second up to TOUCH_BURST. The repeated cells of the update
+/// and the owned cells are dropped before the event, as well as the touches over the bucket. Dropped touches
+/// are still acknowledged, so the client rolls back their predictions.
 class TouchServer : public Component
 {
     URHO3D_OBJECT(TouchServer, Component);
@@ -22,17 +65,74 @@ public:
     explicit TouchServer(Context * context);
     static void RegisterObject(Context * context);
 
+    /// Set the sustained touch rate per second and the burst size of every connection.
+    void SetRateLimit(float rate, float burst);
+    /// Return the counters of the connection or null.
+    const TouchStats * GetStats(Connection * connection) const;
+    /// Return the counters of all the connections since the start.
+    const TouchStats & GetTotalStats() const { return totalStats_; }
+
+    /// Send E_TOUCHREACTION for every queued touch.
+    void ProcessTouches(unsigned tick);
+    /// Tell the clients which touches are processed, after the board deltas of the same tick are sent.
+    void SendAcks(unsigned tick);
+
 protected:
 
     void OnSceneSet(Scene * scene);
 
 private:
 
-    void ProcessConnection(Connection * connection);
+    void HandleNetworkMessage(StringHash eventType, VariantMap & eventData);
+    void HandleClientDisconnected(StringHash eventType, VariantMap & eventData);
 
 private:
 
+    struct ConnectionInput
+    {
+        ConnectionInput()
+            : touches_(MAX_QUEUED_TOUCHES)
+            , nextSequence_(0)
+            , skipSequence_(0)
+            , tokens_(TOUCH_BURST)
+            , lastRefill_(-1.0f)
+            , pending_(false)
+            , ackPending_(false)
+        {}
+
+        /// Touches received since the last update.
+        TouchQueue touches_;
+        /// Touches with lower sequence are already processed.
+        unsigned nextSequence_;
+        /// Touches with lower sequence were dropped on arrival.
+        unsigned skipSequence_;
+        /// Token bucket of the touches.
+        float tokens_;
+        /// Time of the last bucket refill.
+        float lastRefill_;
+        TouchStats stats_;
+        /// Connection is in the pending list.
+        bool pending_;
+        /// Connection is in the acknowledgement list.
+        bool ackPending_;
+    };
+
     WeakPtr<Scene> scene_;
+    HashMap<Connection*, ConnectionInput> inputs_;
+    /// Connections with queued touches.
+    PODVector<Connection*> pending_;
+    /// Connections with processed touches to acknowledge.
+    PODVector<Connection*> acks_;
+    /// Touches of the batch being queued.
+    PODVector<TouchData> batch_;
+    /// Touches being dispatched.
+    PODVector<TouchData> touches_;
+    /// Cells dispatched for the connection in this update.
+    HashSet<unsigned> cells_;
+    float touchRate_;
+    float touchBurst_;
+    TouchStats totalStats_;
+    VectorBuffer message_;
 };
 
 #endif // _TOUCH_SERVER_H_INCLUDED__